@@ -0,0 +1,16 @@
+#include "alloc_counter.hpp"
+
+namespace {
+
+bool counting = false;
+thread_local std::uint64_t thread_allocations = 0;
+
+} // namespace
+
+bool alloc_counter::enabled() { return counting; }
+
+std::uint64_t alloc_counter::thread_count() { return thread_allocations; }
+
+void alloc_counter::enable() { counting = true; }
+
+void alloc_counter::record() { ++thread_allocations; }
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts allocations per thread, so steady-state paths can check they stay allocation-free. Only
+// binaries that link alloc_counter_new.cpp, which replaces the global operator new/delete, count
+// anything, so the server itself doesn't pay for it.
+namespace alloc_counter {
+
+// Whether this binary counts allocations at all.
+bool enabled();
+
+// Number of operator new calls made by the calling thread so far, always 0 unless enabled.
+std::uint64_t thread_count();
+
+// Called by the replacement operator new.
+void enable();
+void record();
+
+} // namespace alloc_counter
@@ -0,0 +1,69 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new/delete with versions that count allocations per thread. Only
+// linked into the loopback check and the benchmarks.
+namespace {
+
+[[maybe_unused]] const auto enabled = (alloc_counter::enable(), true);
+
+void *allocate(std::size_t size) noexcept {
+  alloc_counter::record();
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocate(std::size_t size, std::align_val_t align) noexcept {
+  alloc_counter::record();
+
+  // aligned_alloc wants the size to be a multiple of the alignment.
+  const auto alignment = static_cast<std::size_t>(align);
+  const auto rounded = ((size == 0 ? 1 : size) + alignment - 1) & ~(alignment - 1);
+  return std::aligned_alloc(alignment, rounded);
+}
+
+template <typename... Args> void *allocate_or_throw(Args... args) {
+  if (auto *ptr = allocate(args...)) {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return allocate_or_throw(size); }
+void *operator new[](std::size_t size) { return allocate_or_throw(size); }
+void *operator new(std::size_t size, std::align_val_t align) {
+  return allocate_or_throw(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align) {
+  return allocate_or_throw(size, align);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return allocate(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return allocate(size, align);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
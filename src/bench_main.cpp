@@ -0,0 +1,632 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <unistd.h>
+#include <zmq.hpp>
+
+#include "calibration.hpp"
+#include "color_temp.hpp"
+#include "consts.hpp"
+#include "draw_commands.hpp"
+#include "frame_compression.hpp"
+#include "frame_decoder.hpp"
+#include "frame_hash.hpp"
+#include "frame_socket.hpp"
+#include "memory_canvas.hpp"
+#include "messages.hpp"
+#include "pixel_kernel.hpp"
+#include "shm_ring.hpp"
+#include "test_pattern.hpp"
+
+namespace {
+
+struct Workload {
+  std::string name;
+  std::vector<std::uint32_t> pixels;
+};
+
+// One measurement, e.g. suite "kernel", name "avx2 64x32", metric "frame", value 1.2, unit "us".
+struct Result {
+  std::string suite;
+  std::string name;
+  std::string metric;
+  double value;
+  std::string unit;
+};
+
+using Results = std::vector<Result>;
+
+struct PanelSize {
+  int width;
+  int height;
+};
+
+constexpr PanelSize panel_sizes[] = {
+    {32, 32}, {64, 32}, {64, 64}, {128, 64}, {128, 128}, {256, 128},
+};
+
+// Keeps the compiler from optimizing away work whose result is otherwise unused.
+template <typename T> void keep(const T &value) { asm volatile("" : : "g"(&value) : "memory"); }
+
+// Average wall time of `fn` in microseconds over `iterations` runs.
+double time_us(int iterations, const std::function<void()> &fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) {
+    fn();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+std::string size_name(int width, int height) {
+  return std::to_string(width) + "x" + std::to_string(height);
+}
+
+std::vector<Workload> make_workloads(int width, int height) {
+  std::vector<Workload> workloads;
+  const auto pixel_count = width * height;
+
+  auto &pattern = workloads.emplace_back("test-pattern", std::vector<std::uint32_t>(pixel_count));
+  test_pattern::render(pattern.pixels, width, height);
+
+  workloads.emplace_back("flat", std::vector<std::uint32_t>(pixel_count, 0x00204080));
+
+  // Vertical color bars.
+  auto &bars = workloads.emplace_back("bars", std::vector<std::uint32_t>(pixel_count));
+  const std::uint32_t bar_colors[] = {0xFFFFFF, 0x00FFFF, 0xFFFF00, 0x00FF00,
+                                      0xFF00FF, 0x0000FF, 0xFF0000, 0x000000};
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      bars.pixels[y * width + x] = bar_colors[(x * 8) / width];
+    }
+  }
+
+  // A clock-like screen: flat background with a band of blocky glyphs.
+  auto &clock = workloads.emplace_back("clock", std::vector<std::uint32_t>(pixel_count, 0));
+  std::mt19937 rng(42);
+  for (auto y = height / 3; y < 2 * height / 3; ++y) {
+    for (auto x = 2; x < width - 2; ++x) {
+      if ((x / 3 + y / 3 + rng() % 2) % 3 == 0) {
+        clock.pixels[y * width + x] = 0x0000C0FF;
+      }
+    }
+  }
+
+  auto &noise = workloads.emplace_back("noise", std::vector<std::uint32_t>(pixel_count));
+  for (auto &pixel : noise.pixels) {
+    pixel = rng();
+  }
+
+  return workloads;
+}
+
+// The "before" case: the per-pixel divisions update_matrix used before the lookup tables and
+// vector kernels.
+void convert_divide(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                       const pixel_kernel::Scale &scale) {
+  for (std::size_t i = 0; i < count; ++i) {
+    auto r = (src[i] >> 0) & 0xFF;
+    auto g = (src[i] >> 8) & 0xFF;
+    auto b = (src[i] >> 16) & 0xFF;
+
+    r = (((r * scale.brightness) / 255) * scale.r) / 255;
+    g = (((g * scale.brightness) / 255) * scale.g) / 255;
+    b = (((b * scale.brightness) / 255) * scale.b) / 255;
+
+    dst[i] = r | (g << 8) | (b << 16);
+  }
+}
+
+// What update_matrix does for a fully changed frame: convert every row and draw it, then present.
+void bench_kernel(int iterations, Results &results) {
+  const auto scale = pixel_kernel::make_scale(200, color_temp::get(4000));
+
+  std::vector<std::pair<std::string, pixel_kernel::ConvertFn>> paths = {
+      {"before-divide", convert_divide}};
+  for (const auto path : {pixel_kernel::Path::Scalar, pixel_kernel::Path::Sse2,
+                          pixel_kernel::Path::Avx2, pixel_kernel::Path::Neon}) {
+    if (pixel_kernel::is_supported(path)) {
+      paths.emplace_back(pixel_kernel::name(path), pixel_kernel::get(path));
+    }
+  }
+
+  for (const auto [width, height] : panel_sizes) {
+    std::vector<std::uint32_t> frame(width * height);
+    test_pattern::render(frame, width, height);
+    std::vector<std::uint32_t> converted(frame.size());
+    std::vector<std::uint32_t> row(width);
+    lmz::MemoryCanvas canvas(width, height);
+
+    for (const auto &[path_name, convert] : paths) {
+      const auto name = path_name + " " + size_name(width, height);
+
+      const auto convert_us = time_us(
+          iterations, [&] { convert(frame.data(), converted.data(), frame.size(), scale); });
+      const auto frame_us = time_us(iterations, [&] {
+        for (auto y = 0; y < height; ++y) {
+          convert(frame.data() + y * width, row.data(), width, scale);
+          canvas.set_row(y, row);
+        }
+        canvas.present();
+      });
+
+      results.push_back({"kernel", name, "convert", convert_us, "us"});
+      results.push_back({"kernel", name, "frame", frame_us, "us"});
+    }
+  }
+}
+
+// update_matrix's row conversion with no calibration, with every 32x32 tile corrected and with
+// every other tile corrected, plus the cost of refolding the tables on a brightness change.
+void bench_calibration(int iterations, Results &results) {
+  constexpr auto tile_size = 32;
+  const auto scale = pixel_kernel::make_scale(200, color_temp::get(4000));
+
+  for (const auto [width, height] : panel_sizes) {
+    std::vector<std::uint32_t> frame(width * height);
+    test_pattern::render(frame, width, height);
+    std::vector<std::uint32_t> row(width);
+
+    calibration::Calibration all;
+    calibration::Calibration half;
+    for (auto y = 0; y < height / tile_size; ++y) {
+      for (auto x = 0; x < width / tile_size; ++x) {
+        const calibration::TileCorrection correction = {.gain = {0.95f, 0.9f, 0.85f},
+                                                        .gamma = {1.0f, 1.05f, 1.1f}};
+        all.tiles[{x, y}] = correction;
+        if ((x + y) % 2 == 0) {
+          half.tiles[{x, y}] = correction;
+        }
+      }
+    }
+
+    const std::pair<std::string, calibration::Calibration> cases[] = {
+        {"none", {}}, {"half", half}, {"all", all}};
+    for (const auto &[case_name, calibration] : cases) {
+      calibration::Compiled tables(calibration, width, height, tile_size, tile_size);
+      tables.rescale(scale.tables);
+      const auto name = case_name + " " + size_name(width, height);
+
+      const auto frame_us = time_us(iterations, [&] {
+        for (auto y = 0; y < height; ++y) {
+          if (tables.empty()) {
+            pixel_kernel::convert(frame.data() + y * width, row.data(), width, scale);
+          } else {
+            tables.convert_row(y, frame.data() + y * width, row.data(), width, scale);
+          }
+          keep(row);
+        }
+      });
+      results.push_back({"calibration", name, "frame", frame_us, "us"});
+
+      if (!tables.empty()) {
+        const auto rescale_us = time_us(iterations, [&] {
+          tables.rescale(scale.tables);
+          keep(tables);
+        });
+        results.push_back({"calibration", name, "rescale", rescale_us, "us"});
+      }
+    }
+  }
+}
+
+void bench_color_temp(int iterations, Results &results) {
+  constexpr auto step = 100;
+  for (auto kelvin = color_temp::min; kelvin <= color_temp::max; kelvin += step * 5) {
+    const auto us = time_us(iterations, [&] { keep(color_temp::get(kelvin)); });
+    results.push_back({"color-temp", std::to_string(kelvin) + "K", "get", us * 1000, "ns"});
+  }
+
+  constexpr auto sweep_count = (color_temp::max - color_temp::min) / step + 1;
+  const auto sweep_us = time_us(iterations, [&] {
+    for (auto kelvin = color_temp::min; kelvin <= color_temp::max; kelvin += step) {
+      keep(color_temp::get(kelvin));
+    }
+  });
+  results.push_back({"color-temp", "sweep", "get", sweep_us * 1000 / sweep_count, "ns"});
+}
+
+template <lmz::IsMessage MessageT>
+void bench_message(const std::string &name, const MessageT &message, int iterations,
+                   Results &results) {
+  const auto data = std::span<const std::byte>(reinterpret_cast<const std::byte *>(&message),
+                                               sizeof(message));
+
+  const auto id_us = time_us(iterations, [&] { keep(lmz::get_id_from_data(data)); });
+  const auto parse_us =
+      time_us(iterations, [&] { keep(lmz::get_message_from_data<MessageT>(data)); });
+
+  results.push_back({"messages", name, "get_id_from_data", id_us * 1000, "ns"});
+  results.push_back({"messages", name, "get_message_from_data", parse_us * 1000, "ns"});
+}
+
+void bench_messages(int iterations, Results &results) {
+  bench_message("set-brightness", lmz::SetBrightnessRequest{.args = {.brightness = 128}},
+                iterations, results);
+  bench_message("set-temperature", lmz::SetTemperatureRequest{.args = {.temperature = 4000}},
+                iterations, results);
+  bench_message("get-stats-reply", lmz::GetStatsReply{.args = {}}, iterations, results);
+}
+
+// Sends `iterations` frames through a frame socket pair in this process and times them. REQ/REP
+// reports round trip times, pipelined modes report how fast frames get through.
+void bench_transport(const std::string &endpoint, frame_socket::Mode mode, int width, int height,
+                     int iterations, Results &results) {
+  const frame_socket::Options options = {
+      .mode = mode,
+      .drop_policy = frame_socket::DropPolicy::Block,
+      .hwm = 1000,
+  };
+  const std::size_t frame_size = width * height * consts::pixel_size;
+  std::vector<std::uint32_t> frame(width * height);
+  test_pattern::render(frame, width, height);
+
+  zmq::context_t ctx;
+  std::atomic<bool> bound = false;
+  std::thread receiver([&] {
+    auto sock = frame_socket::make_receiver(ctx, options);
+    sock.bind(endpoint);
+    bound = true;
+
+    std::vector<std::byte> buffer(frame_size);
+    for (auto i = 0; i < iterations; ++i) {
+      static_cast<void>(sock.recv(zmq::mutable_buffer(buffer.data(), buffer.size())));
+      frame_socket::acknowledge_frame(sock, options);
+    }
+  });
+
+  while (!bound) {
+    std::this_thread::yield();
+  }
+
+  auto sock = frame_socket::make_sender(ctx, options);
+  sock.connect(endpoint);
+
+  std::vector<double> rtts;
+  rtts.reserve(iterations);
+  const auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) {
+    const auto sent = std::chrono::steady_clock::now();
+    frame_socket::send_frame(sock, options, zmq::const_buffer(frame.data(), frame_size));
+    rtts.push_back(
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent)
+            .count());
+  }
+  receiver.join();
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+  sock.close();
+
+  const auto name = endpoint.substr(0, endpoint.find(':')) + " " + frame_socket::name(mode) +
+                    " " + size_name(width, height);
+  results.push_back({"transport", name, "throughput", iterations / elapsed.count(), "fps"});
+
+  if (mode == frame_socket::Mode::ReqRep) {
+    std::sort(rtts.begin(), rtts.end());
+    results.push_back({"transport", name, "rtt_p50", rtts[rtts.size() / 2], "us"});
+    results.push_back({"transport", name, "rtt_p99", rtts[rtts.size() * 99 / 100], "us"});
+  }
+}
+
+// The shared memory ring with a consumer that takes each frame like the server does, and a
+// producer that waits for that before writing the next one, so round trips compare with ReqRep.
+void bench_shm_transport(int width, int height, int iterations, Results &results) {
+  std::vector<std::uint32_t> frame(width * height);
+  test_pattern::render(frame, width, height);
+
+  const auto name = "/lmz-bench-" + std::to_string(getpid());
+  auto consumer = lmz::ShmRing::create(name, width, height);
+  auto producer = lmz::ShmRing::open(name);
+  std::atomic<int> consumed = 0;
+
+  std::thread receiver([&] {
+    auto seen = consumer.published();
+    while (consumed < iterations) {
+      consumer.wait(seen, std::chrono::milliseconds(100));
+      seen = consumer.published();
+      if (consumer.consume()) {
+        consumed++;
+        consumed.notify_one();
+      }
+    }
+  });
+
+  std::vector<double> rtts;
+  rtts.reserve(iterations);
+  const auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) {
+    const auto sent = std::chrono::steady_clock::now();
+    const auto bytes = std::as_bytes(std::span(frame));
+    std::copy(bytes.begin(), bytes.end(), producer.write_frame().begin());
+    producer.publish();
+    for (auto current = consumed.load(); current <= i; current = consumed.load()) {
+      consumed.wait(current);
+    }
+    rtts.push_back(
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent)
+            .count());
+  }
+  receiver.join();
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  const auto result_name = "shm " + size_name(width, height);
+  results.push_back({"transport", result_name, "throughput", iterations / elapsed.count(), "fps"});
+  std::sort(rtts.begin(), rtts.end());
+  results.push_back({"transport", result_name, "rtt_p50", rtts[rtts.size() / 2], "us"});
+  results.push_back({"transport", result_name, "rtt_p99", rtts[rtts.size() * 99 / 100], "us"});
+}
+
+void bench_transports(int width, int height, int iterations, Results &results) {
+  const auto ipc_endpoint = "ipc:///tmp/lmz-bench-" + std::to_string(getpid()) + ".sock";
+  for (const auto &endpoint : {std::string("inproc://lmz-bench"), ipc_endpoint}) {
+    for (const auto mode : {frame_socket::Mode::ReqRep, frame_socket::Mode::PushPull}) {
+      bench_transport(endpoint, mode, width, height, iterations, results);
+    }
+  }
+  bench_shm_transport(width, height, iterations, results);
+}
+
+void bench_compression(int width, int height, int iterations, Results &results) {
+  for (const auto &workload : make_workloads(width, height)) {
+    const auto frame = std::as_bytes(std::span(workload.pixels));
+    std::vector<std::byte> compressed;
+    std::vector<std::byte> decompressed(frame.size());
+
+    const auto encode_us = time_us(iterations, [&] {
+      compressed.clear();
+      frame_compression::compress(frame, compressed);
+    });
+    const auto decode_us =
+        time_us(iterations, [&] { frame_compression::decompress(compressed, decompressed); });
+
+    const auto name = workload.name + " " + size_name(width, height);
+    results.push_back(
+        {"compression", name, "ratio", double(frame.size()) / double(compressed.size()), "x"});
+    results.push_back({"compression", name, "encode", encode_us, "us"});
+    results.push_back({"compression", name, "decode", decode_us, "us"});
+  }
+}
+
+// What a producer pays to hash each frame, and what the server pays to cache a frame and to show
+// one again by hash, cycling through more screens than the cache holds half the time.
+void bench_frame_cache(int width, int height, int iterations, Results &results) {
+  const std::size_t frame_size = width * height * consts::pixel_size;
+  constexpr auto screen_count = 16;
+
+  std::vector<std::vector<std::byte>> screens;
+  std::vector<lmz::FrameHash> hashes;
+  for (auto i = 0; i < screen_count; ++i) {
+    std::vector<std::uint32_t> pixels(width * height);
+    test_pattern::render(pixels, width, height);
+    std::rotate(pixels.begin(), pixels.begin() + i * width, pixels.end());
+
+    const auto bytes = std::as_bytes(std::span(pixels));
+    screens.emplace_back(bytes.begin(), bytes.end());
+    hashes.push_back(frame_hash::hash(screens.back()));
+  }
+
+  auto next = 0;
+  const auto hash_us = time_us(iterations, [&] {
+    keep(frame_hash::hash(screens[next++ % screen_count]));
+  });
+
+  std::vector<std::vector<std::byte>> cacheable;
+  for (auto i = 0; i < screen_count; ++i) {
+    const lmz::CacheableFrameHeader header = {.hash = hashes[i]};
+    cacheable.emplace_back(sizeof(header) + frame_size);
+    std::memcpy(cacheable.back().data(), &header, sizeof(header));
+    std::memcpy(cacheable.back().data() + sizeof(header), screens[i].data(), frame_size);
+  }
+
+  const auto name = size_name(width, height);
+  for (const auto budget_frames : {screen_count, screen_count / 2}) {
+    lmz::FrameDecoder decoder(width, height, budget_frames * frame_size);
+    std::vector<std::byte> frame(frame_size);
+
+    next = 0;
+    const auto insert_us = time_us(iterations, [&] {
+      decoder.decode(cacheable[next++ % screen_count], frame);
+    });
+
+    auto hits = 0;
+    next = 0;
+    const auto show_us = time_us(iterations, [&] {
+      const lmz::CachedFrameHeader header = {.hash = hashes[next++ % screen_count]};
+      decoder.decode({reinterpret_cast<const std::byte *>(&header), sizeof(header)}, frame);
+      hits += *decoder.cache_hit();
+    });
+
+    const auto case_name = name + " " + std::to_string(budget_frames) + "/" +
+                           std::to_string(screen_count) + " screens cached";
+    results.push_back({"cache", case_name, "cacheable", insert_us, "us"});
+    results.push_back({"cache", case_name, "cached", show_us, "us"});
+    results.push_back({"cache", case_name, "hit_rate", 100.0 * hits / iterations, "%"});
+  }
+
+  results.push_back({"cache", name, "hash", hash_us, "us"});
+  results.push_back({"cache", name, "message", double(sizeof(lmz::CachedFrameHeader)), "bytes"});
+}
+
+// A dashboard-like command list: a background, panels, a chart, icons from the atlas and lines
+// of text. Reports its size on the wire next to a plain frame, and how long the server takes to
+// rasterize it.
+void bench_draw(int width, int height, int iterations, Results &results) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  std::vector<std::uint8_t> glyphs(96 * 8);
+  std::generate(glyphs.begin(), glyphs.end(), [&] { return byte(rng); });
+  std::vector<std::uint32_t> icons(64 * 16);
+  std::generate(icons.begin(), icons.end(), [&] { return 0xff000000 | byte(rng) * 0x010101u; });
+
+  lmz::FrameDecoder decoder(width, height);
+  std::vector<std::byte> frame(width * height * consts::pixel_size);
+  decoder.decode(draw_commands::font_message(8, 8, ' ', glyphs), frame);
+  decoder.decode(draw_commands::atlas_message(64, 16, icons), frame);
+
+  draw_commands::CommandList commands;
+  commands.fill_rect(0, 0, width, height, 0xff101010);
+  for (auto i = 0; i < 4; ++i) {
+    commands.fill_rect(2 + i * width / 4, 2, width / 4 - 4, height / 2 - 4, 0xff303030);
+    commands.blit(i * 16, 0, 16, 16, 4 + i * width / 4, 4);
+  }
+  for (auto x = 0; x + 8 < width; x += 8) {
+    commands.line(x, height - 1 - byte(rng) % (height / 2), x + 8,
+                  height - 1 - byte(rng) % (height / 2), 0xff00c0ff);
+  }
+  for (auto line = 0; line < 6; ++line) {
+    commands.text(2, 24 + line * 10, 0xffffffff, "Temp " + std::to_string(20 + line) + ".5C");
+  }
+
+  const auto message = commands.message();
+  const auto draw_us = time_us(iterations, [&] { decoder.decode(message, frame); });
+
+  const auto name = "dashboard " + size_name(width, height);
+  results.push_back({"draw", name, "message", double(message.size()), "bytes"});
+  results.push_back({"draw", name, "frame", double(frame.size()), "bytes"});
+  results.push_back({"draw", name, "draw", draw_us, "us"});
+}
+
+void print_text(const Results &results) {
+  std::string suite;
+  for (const auto &result : results) {
+    if (result.suite != suite) {
+      std::cout << (suite.empty() ? "" : "\n") << result.suite << std::endl;
+      suite = result.suite;
+    }
+
+    std::cout << "  " << std::left << std::setw(28) << result.name << std::setw(24)
+              << result.metric << std::right << std::fixed << std::setprecision(2)
+              << std::setw(14) << result.value << " " << result.unit << std::endl;
+  }
+}
+
+void print_csv(const Results &results) {
+  std::cout << "suite,name,metric,value,unit" << std::endl;
+  for (const auto &result : results) {
+    std::cout << result.suite << "," << result.name << "," << result.metric << ","
+              << std::defaultfloat << std::setprecision(6) << result.value << ","
+              << result.unit << std::endl;
+  }
+}
+
+void print_json(const Results &results) {
+  // None of the strings ever need escaping, they are all built from fixed names and numbers.
+  std::cout << "[" << std::endl;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto &result = results[i];
+    std::cout << "  {\"suite\": \"" << result.suite << "\", \"name\": \"" << result.name
+              << "\", \"metric\": \"" << result.metric << "\", \"value\": " << std::defaultfloat
+              << std::setprecision(6) << result.value << ", \"unit\": \"" << result.unit << "\"}"
+              << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  std::cout << "]" << std::endl;
+}
+
+std::set<std::string> parse_suites(const std::string &value) {
+  const std::set<std::string> all = {"kernel",    "calibration", "color-temp", "messages",
+                                     "transport", "compression", "draw",       "cache"};
+  if (value == "all") {
+    return all;
+  }
+
+  std::set<std::string> suites;
+  std::stringstream stream(value);
+  std::string suite;
+  while (std::getline(stream, suite, ',')) {
+    if (!all.contains(suite)) {
+      throw std::runtime_error("Unknown suite: " + suite);
+    }
+    suites.insert(suite);
+  }
+
+  return suites;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  argparse::ArgumentParser program("led-matrix-zmq-bench");
+  program.add_description("Benchmarks led-matrix-zmq hot paths");
+
+  program.add_argument("-w", "--width").default_value(128).scan<'i', int>();
+  program.add_argument("-h", "--height").default_value(128).scan<'i', int>();
+  program.add_argument("-n", "--iterations").default_value(1000).scan<'i', int>();
+  program.add_argument("-s", "--suites")
+      .help("Comma separated suites to run: kernel, calibration, color-temp, messages, transport, "
+            "compression, draw, cache or all")
+      .default_value(std::string("all"));
+  program.add_argument("-o", "--output")
+      .help("Output format: text, json or csv")
+      .default_value(std::string("text"));
+
+  std::set<std::string> suites;
+  try {
+    program.parse_args(argc, argv);
+    suites = parse_suites(program.get<std::string>("--suites"));
+
+    const auto output = program.get<std::string>("--output");
+    if (output != "text" && output != "json" && output != "csv") {
+      throw std::runtime_error("Unknown output format: " + output);
+    }
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  const auto width = program.get<int>("--width");
+  const auto height = program.get<int>("--height");
+  const auto iterations = program.get<int>("--iterations");
+  const auto output = program.get<std::string>("--output");
+
+  Results results;
+  if (suites.contains("kernel")) {
+    bench_kernel(iterations, results);
+  }
+  if (suites.contains("calibration")) {
+    bench_calibration(iterations, results);
+  }
+  if (suites.contains("color-temp")) {
+    bench_color_temp(iterations, results);
+  }
+  if (suites.contains("messages")) {
+    bench_messages(iterations * 100, results);
+  }
+  if (suites.contains("transport")) {
+    bench_transports(width, height, iterations, results);
+  }
+  if (suites.contains("compression")) {
+    bench_compression(width, height, iterations, results);
+  }
+  if (suites.contains("draw")) {
+    bench_draw(width, height, iterations, results);
+  }
+  if (suites.contains("cache")) {
+    bench_frame_cache(width, height, iterations, results);
+  }
+
+  if (output == "json") {
+    print_json(results);
+  } else if (output == "csv") {
+    print_csv(results);
+  } else {
+    print_text(results);
+  }
+
+  return 0;
+}
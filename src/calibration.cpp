@@ -0,0 +1,174 @@
+#include "calibration.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr float gain_min = 0.0f;
+constexpr float gain_max = 2.0f;
+constexpr float gamma_min = 0.2f;
+constexpr float gamma_max = 5.0f;
+
+void read_channels(std::istringstream &words, std::array<float, 3> &channels) {
+  for (auto &channel : channels) {
+    if (!(words >> channel) || !std::isfinite(channel)) {
+      throw std::runtime_error("expected three numbers");
+    }
+  }
+}
+
+color_lut::ChannelTable build_curve(float gain, float gamma) {
+  color_lut::ChannelTable table;
+
+  for (auto i = 0; i < static_cast<int>(table.size()); ++i) {
+    const auto value = 255.0f * gain * std::pow(i / 255.0f, gamma);
+    table[i] = static_cast<std::uint8_t>(std::clamp(std::lround(value), 0L, 255L));
+  }
+
+  return table;
+}
+
+} // namespace
+
+calibration::Calibration calibration::parse(std::istream &in) {
+  Calibration calibration;
+
+  std::string line;
+  for (auto line_number = 1; std::getline(in, line); ++line_number) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+
+    std::string keyword;
+    if (!(words >> keyword)) {
+      continue;
+    }
+
+    try {
+      if (keyword == "tile-size") {
+        if (!(words >> calibration.tile_width >> calibration.tile_height) ||
+            calibration.tile_width <= 0 || calibration.tile_height <= 0) {
+          throw std::runtime_error("expected a width and height");
+        }
+      } else if (keyword == "tile") {
+        int x, y;
+        if (!(words >> x >> y) || x < 0 || y < 0) {
+          throw std::runtime_error("expected a tile column and row");
+        }
+
+        // A tile listed twice is most likely a typo for a neighbour, which would go uncorrected.
+        const auto [entry, added] = calibration.tiles.try_emplace({x, y});
+        if (!added) {
+          throw std::runtime_error("tile " + std::to_string(x) + "," + std::to_string(y) +
+                                   " is listed twice");
+        }
+
+        auto &correction = entry->second;
+        std::string property;
+        while (words >> property) {
+          if (property == "gain") {
+            read_channels(words, correction.gain);
+          } else if (property == "gamma") {
+            read_channels(words, correction.gamma);
+          } else {
+            throw std::runtime_error("unknown property " + property);
+          }
+        }
+      } else {
+        throw std::runtime_error("unknown keyword " + keyword);
+      }
+    } catch (const std::runtime_error &err) {
+      throw std::runtime_error("Calibration line " + std::to_string(line_number) + ": " +
+                               err.what());
+    }
+  }
+
+  return calibration;
+}
+
+calibration::Calibration calibration::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Could not open calibration: " + path);
+  }
+
+  return parse(file);
+}
+
+calibration::TileCorrection calibration::clamp(const TileCorrection &correction) {
+  TileCorrection clamped;
+  for (auto c = 0; c < 3; ++c) {
+    clamped.gain[c] = std::clamp(correction.gain[c], gain_min, gain_max);
+    clamped.gamma[c] = std::clamp(correction.gamma[c], gamma_min, gamma_max);
+  }
+
+  return clamped;
+}
+
+color_lut::Tables calibration::build_curves(const TileCorrection &correction) {
+  const auto clamped = clamp(correction);
+  return color_lut::Tables{
+      .r = build_curve(clamped.gain[0], clamped.gamma[0]),
+      .g = build_curve(clamped.gain[1], clamped.gamma[1]),
+      .b = build_curve(clamped.gain[2], clamped.gamma[2]),
+  };
+}
+
+calibration::Compiled::Compiled(const Calibration &calibration, int width, int height,
+                                int default_tile_width, int default_tile_height) {
+  tile_w = calibration.tile_width > 0 ? calibration.tile_width : default_tile_width;
+  tile_h = calibration.tile_height > 0 ? calibration.tile_height : default_tile_height;
+  if (tile_w <= 0 || tile_h <= 0) {
+    tile_w = width;
+    tile_h = height;
+  }
+
+  tiles_x = (width + tile_w - 1) / tile_w;
+  const auto tiles_y = (height + tile_h - 1) / tile_h;
+  tile_index.assign(tiles_x * tiles_y, -1);
+
+  for (const auto &[tile, correction] : calibration.tiles) {
+    const auto [x, y] = tile;
+    if (x >= tiles_x || y >= tiles_y) {
+      throw std::runtime_error("Calibrated tile " + std::to_string(x) + "," + std::to_string(y) +
+                               " is outside the " + std::to_string(tiles_x) + "x" +
+                               std::to_string(tiles_y) + " tile canvas");
+    }
+
+    tile_index[y * tiles_x + x] = static_cast<int>(tile_curves.size());
+    tile_curves.push_back(build_curves(correction));
+  }
+
+  tile_tables.resize(tile_curves.size());
+}
+
+void calibration::Compiled::rescale(const color_lut::Tables &scale) {
+  for (std::size_t i = 0; i < tile_curves.size(); ++i) {
+    const auto &curves = tile_curves[i];
+    auto &tables = tile_tables[i];
+
+    for (std::size_t v = 0; v < tables.r.size(); ++v) {
+      tables.r[v] = curves.r[scale.r[v]];
+      tables.g[v] = curves.g[scale.g[v]];
+      tables.b[v] = curves.b[scale.b[v]];
+    }
+  }
+}
+
+void calibration::Compiled::convert_row(int y, const std::uint32_t *src, std::uint32_t *dst,
+                                        int width, const pixel_kernel::Scale &scale) const {
+  const auto *row_tiles = tile_index.data() + (y / tile_h) * tiles_x;
+
+  for (auto x = 0; x < width; x += tile_w) {
+    const auto count = std::min(tile_w, width - x);
+    const auto index = row_tiles[x / tile_w];
+    if (index < 0) {
+      pixel_kernel::convert(src + x, dst + x, count, scale);
+    } else {
+      pixel_kernel::convert_tables(src + x, dst + x, count, tile_tables[index]);
+    }
+  }
+}
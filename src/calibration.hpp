@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "color_lut.hpp"
+#include "pixel_kernel.hpp"
+
+namespace calibration {
+
+// Corrects one panel's response per channel (r, g, b): out = 255 * gain * (in / 255) ^ gamma.
+struct TileCorrection {
+  std::array<float, 3> gain = {1.0f, 1.0f, 1.0f};
+  std::array<float, 3> gamma = {1.0f, 1.0f, 1.0f};
+};
+
+// Corrections for the tiles of a canvas, by tile column and row. Tiles without one are drawn as
+// they are.
+struct Calibration {
+  int tile_width = 0; // 0 means the panel size the server was started with
+  int tile_height = 0;
+  std::map<std::pair<int, int>, TileCorrection> tiles;
+};
+
+// Reads the text format described in the README, e.g.:
+//
+//   tile-size 64 32
+//   tile 0 0 gain 1.0 0.96 0.92
+//   tile 1 0 gain 0.94 1.0 0.97 gamma 1.0 1.0 1.1
+//
+// Throws std::runtime_error on anything it doesn't understand.
+Calibration parse(std::istream &in);
+Calibration load(const std::string &path);
+
+// Clamps a correction to what the tables can sensibly represent.
+TileCorrection clamp(const TileCorrection &correction);
+
+// A correction as one lookup table per channel. This is the only place doing float math.
+color_lut::Tables build_curves(const TileCorrection &correction);
+
+// Per-tile lookup tables for a whole canvas, with the brightness and temperature tables folded
+// in so a corrected pixel costs one lookup per channel. Tiles without a correction keep using the
+// vector kernels.
+class Compiled {
+public:
+  Compiled() = default;
+  Compiled(const Calibration &calibration, int width, int height, int default_tile_width,
+           int default_tile_height);
+
+  bool empty() const { return tile_curves.empty(); }
+  int tile_width() const { return tile_w; }
+  int tile_height() const { return tile_h; }
+  std::size_t tile_count() const { return tile_curves.size(); }
+
+  // Refolds the scale into every tile's tables. Call whenever brightness or temperature change.
+  void rescale(const color_lut::Tables &scale);
+
+  // Converts row `y` of the canvas, `width` pixels long, like pixel_kernel::convert does.
+  void convert_row(int y, const std::uint32_t *src, std::uint32_t *dst, int width,
+                   const pixel_kernel::Scale &scale) const;
+
+private:
+  int tile_w = 0;
+  int tile_h = 0;
+  int tiles_x = 0;
+
+  // Index into tile_curves and tile_tables for each tile of the canvas, -1 for uncorrected.
+  std::vector<int> tile_index;
+  std::vector<color_lut::Tables> tile_curves;
+  std::vector<color_lut::Tables> tile_tables;
+};
+
+} // namespace calibration
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace lmz {
+
+// Where the server draws its frames. Canvases are double (or more) buffered: rows are written
+// to the back buffer, then present() shows it and moves on to the next back buffer. Buffers
+// keep their contents, so the server only has to redraw rows that changed since the buffer was
+// last drawn.
+class Canvas {
+public:
+  virtual ~Canvas() = default;
+
+  virtual int width() const = 0;
+  virtual int height() const = 0;
+
+  // How many buffers present() cycles through, and which one is currently the back buffer.
+  virtual int buffer_count() const = 0;
+  virtual int back_buffer() const = 0;
+
+  // Writes one row of RGB pixels, red in the low byte and the top byte ignored, to the back
+  // buffer.
+  virtual void set_row(int y, std::span<const std::uint32_t> pixels) = 0;
+
+  // Shows the back buffer. May block until the display is ready for it.
+  virtual void present() = 0;
+};
+
+} // namespace lmz
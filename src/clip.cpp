@@ -0,0 +1,55 @@
+#include "clip.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "consts.hpp"
+
+clip::Clip::Clip(const std::string &path) : clip_path(path), header{}, mapping(nullptr) {
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open clip: " + path + ": " + std::strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error("Clip is too small to hold a header: " + path);
+  }
+
+  mapping_size = st.st_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Could not map clip: " + path + ": " + std::strerror(errno));
+  }
+
+  std::memcpy(&header, mapping, sizeof(header));
+
+  // Sizes come from the file, so none of this may overflow.
+  const auto frame_size = std::size_t{header.width} * header.height * consts::pixel_size;
+  if (header.magic != magic || frame_size == 0 || header.frame_count == 0 ||
+      header.frame_interval_us == 0 ||
+      header.frame_count > (mapping_size - sizeof(Header)) / frame_size) {
+    munmap(mapping, mapping_size);
+    throw std::runtime_error("Not a valid clip, or truncated: " + path);
+  }
+
+  // Playback reads front to back, so let the kernel read ahead.
+  madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+  madvise(mapping, mapping_size, MADV_WILLNEED);
+}
+
+clip::Clip::~Clip() { munmap(mapping, mapping_size); }
+
+std::span<const std::byte> clip::Clip::frame(std::uint32_t index) const {
+  const auto frame_size = std::size_t{header.width} * header.height * consts::pixel_size;
+  const auto *frames = static_cast<const std::byte *>(mapping) + sizeof(Header);
+  return {frames + index * frame_size, frame_size};
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace clip {
+
+constexpr std::uint32_t magic = 0x50494C43; // "CLIP"
+
+// A clip file is this header followed by frame_count RGBA32 frames of width * height pixels.
+#pragma pack(push, 1)
+struct Header {
+  std::uint32_t magic;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint32_t frame_count;
+  std::uint32_t frame_interval_us;
+};
+#pragma pack(pop)
+
+// A clip file mapped into memory, so frames are read straight from the page cache.
+class Clip {
+public:
+  // Throws std::runtime_error if the file can't be mapped or isn't a valid clip.
+  explicit Clip(const std::string &path);
+  ~Clip();
+
+  Clip(const Clip &) = delete;
+  Clip &operator=(const Clip &) = delete;
+
+  const std::string &path() const { return clip_path; }
+  int width() const { return header.width; }
+  int height() const { return header.height; }
+  std::uint32_t frame_count() const { return header.frame_count; }
+  std::chrono::microseconds frame_interval() const {
+    return std::chrono::microseconds(header.frame_interval_us);
+  }
+
+  std::span<const std::byte> frame(std::uint32_t index) const;
+
+private:
+  std::string clip_path;
+  Header header;
+  void *mapping;
+  std::size_t mapping_size;
+};
+
+} // namespace clip
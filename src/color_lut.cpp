@@ -0,0 +1,26 @@
+#include "color_lut.hpp"
+
+#include <tuple>
+
+namespace {
+
+color_lut::ChannelTable build_channel(int brightness, int temperature) {
+  color_lut::ChannelTable table;
+
+  // Keep the same truncating two-step scale the per-pixel code used, so output is unchanged.
+  for (auto i = 0; i < static_cast<int>(table.size()); ++i) {
+    table[i] = static_cast<std::uint8_t>((((i * brightness) / 255) * temperature) / 255);
+  }
+
+  return table;
+}
+
+} // namespace
+
+color_lut::Tables color_lut::build(int brightness, const color_temp::TemperatureColor &temperature) {
+  return Tables{
+      .r = build_channel(brightness, std::get<0>(temperature)),
+      .g = build_channel(brightness, std::get<1>(temperature)),
+      .b = build_channel(brightness, std::get<2>(temperature)),
+  };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "color_temp.hpp"
+
+namespace color_lut {
+
+using ChannelTable = std::array<std::uint8_t, 256>;
+
+// Per-channel lookup tables mapping an input channel value straight to its output value with
+// brightness and color temperature already applied.
+struct Tables {
+  ChannelTable r;
+  ChannelTable g;
+  ChannelTable b;
+};
+
+Tables build(int brightness, const color_temp::TemperatureColor &temperature);
+
+} // namespace color_lut
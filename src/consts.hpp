@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 
 namespace consts {
@@ -9,5 +10,18 @@ constexpr auto bpp = 8 * pixel_size;
 
 const auto default_control_endpoint = "ipc:///run/lmz-control.sock";
 const auto default_frame_endpoint = "ipc:///run/lmz-frame.sock";
+const auto default_shm_name = "/lmz-frames";
+
+// Frame messages other than plain frames (deltas etc.) may be up to this many times the size of
+// a plain frame.
+constexpr auto max_frame_message_factor = 2;
+
+constexpr auto render_report_interval = std::chrono::seconds(10);
+
+// How often the render loop steps brightness and temperature fades.
+constexpr auto fade_step_interval = std::chrono::milliseconds(10);
+
+// How long the shared memory doorbell thread sleeps at most, so it notices the server stopping.
+constexpr auto shm_wait_timeout = std::chrono::milliseconds(100);
 
 } // namespace consts
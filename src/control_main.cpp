@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <argparse/argparse.hpp>
 #include <plog/Appenders/ColorConsoleAppender.h>
@@ -9,7 +11,9 @@
 #include <zmq.hpp>
 
 #include "consts.hpp"
+#include "easing.hpp"
 #include "messages.hpp"
+#include "stats.hpp"
 
 template <lmz::IsMessage SendType>
 const static lmz::MessageReplyType<SendType> send_and_recv(zmq::socket_t &sock,
@@ -24,6 +28,34 @@ const static lmz::MessageReplyType<SendType> send_and_recv(zmq::socket_t &sock,
   return lmz::get_message_from_data<lmz::MessageReplyType<SendType>>(data);
 }
 
+static void print_histogram(const std::string &name,
+                            std::span<const uint64_t, stats::histogram_buckets> buckets) {
+  std::cout << name << " p50<=" << stats::percentile_us(buckets, 0.5)
+            << "us p99<=" << stats::percentile_us(buckets, 0.99)
+            << "us p999<=" << stats::percentile_us(buckets, 0.999)
+            << "us max<=" << stats::percentile_us(buckets, 1.0) << "us" << std::endl;
+}
+
+static void print_clip_status(const lmz::ClipStatusArgs &args) {
+  const char *states[] = {"stopped", "playing", "paused"};
+  const auto state = static_cast<std::size_t>(args.state);
+
+  std::cout << "state " << (state < std::size(states) ? states[state] : "unknown") << std::endl;
+  std::cout << "frame " << args.frame << "/" << args.frame_count << std::endl;
+  std::cout << "frame_interval_us " << args.frame_interval_us << std::endl;
+  std::cout << "rate_percent " << args.rate_percent << std::endl;
+  std::cout << "loop " << std::to_string(args.loop) << std::endl;
+}
+
+static void print_calibration(const lmz::CalibrationArgs &args) {
+  std::cout << "tile_size " << args.tile_width << "x" << args.tile_height << std::endl;
+  std::cout << "calibrated_tiles " << args.tile_count << std::endl;
+}
+
+static lmz::ClipControlRequest clip_control(lmz::ClipAction action, std::uint32_t value = 0) {
+  return lmz::ClipControlRequest{.args = {.action = action, .value = value}};
+}
+
 int main(int argc, char *argv[]) {
   static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
   plog::init(plog::debug, &consoleAppender);
@@ -43,6 +75,25 @@ int main(int argc, char *argv[]) {
       .help("Temperature level (2000K-6500K)")
       .scan<'i', int>();
 
+  argparse::ArgumentParser fade_brightness_command("fade-brightness");
+  fade_brightness_command.add_description("Fade the brightness on the server");
+  fade_brightness_command.add_argument("brightness")
+      .help("Brightness level (0-255)")
+      .scan<'i', int>();
+  fade_brightness_command.add_argument("duration").help("Duration in ms").scan<'i', int>();
+  fade_brightness_command.add_argument("--easing")
+      .help("linear, ease-in, ease-out or ease-in-out")
+      .default_value(std::string("ease-in-out"));
+  argparse::ArgumentParser fade_temperature_command("fade-temperature");
+  fade_temperature_command.add_description("Fade the color temperature on the server");
+  fade_temperature_command.add_argument("temperature")
+      .help("Temperature level (2000K-6500K)")
+      .scan<'i', int>();
+  fade_temperature_command.add_argument("duration").help("Duration in ms").scan<'i', int>();
+  fade_temperature_command.add_argument("--easing")
+      .help("linear, ease-in, ease-out or ease-in-out")
+      .default_value(std::string("ease-in-out"));
+
   argparse::ArgumentParser get_brightness_command("get-brightness");
   get_brightness_command.add_description("Get the brightness");
   argparse::ArgumentParser get_temperature_command("get-temperature");
@@ -51,14 +102,100 @@ int main(int argc, char *argv[]) {
   argparse::ArgumentParser get_configuration_command("get-configuration");
   get_configuration_command.add_description("Get the configuration");
 
+  argparse::ArgumentParser get_stats_command("get-stats");
+  get_stats_command.add_description("Get frame and control statistics");
+  get_stats_command.add_argument("--reset")
+      .help("Reset the statistics after reading them")
+      .default_value(false)
+      .implicit_value(true);
+
+  argparse::ArgumentParser load_clip_command("load-clip");
+  load_clip_command.add_description("Load a clip file on the server and start playing it");
+  load_clip_command.add_argument("path").help("Path to the clip file on the server");
+  load_clip_command.add_argument("--no-loop")
+      .help("Stop on the last frame instead of looping")
+      .default_value(false)
+      .implicit_value(true);
+
+  argparse::ArgumentParser clip_play_command("clip-play");
+  clip_play_command.add_description("Play or resume the loaded clip");
+  argparse::ArgumentParser clip_pause_command("clip-pause");
+  clip_pause_command.add_description("Pause the clip on the current frame");
+  argparse::ArgumentParser clip_stop_command("clip-stop");
+  clip_stop_command.add_description("Stop the clip and go back to live frames");
+  argparse::ArgumentParser clip_seek_command("clip-seek");
+  clip_seek_command.add_description("Jump to a frame of the clip");
+  clip_seek_command.add_argument("frame").scan<'i', int>();
+  argparse::ArgumentParser clip_rate_command("clip-rate");
+  clip_rate_command.add_description("Set the clip playback rate");
+  clip_rate_command.add_argument("percent")
+      .help("Percent of the clip's own frame rate")
+      .scan<'i', int>();
+  argparse::ArgumentParser clip_loop_command("clip-loop");
+  clip_loop_command.add_description("Turn clip looping on (1) or off (0)");
+  clip_loop_command.add_argument("loop").scan<'i', int>();
+  argparse::ArgumentParser clip_status_command("clip-status");
+  clip_status_command.add_description("Get the clip playback state");
+
+  argparse::ArgumentParser load_calibration_command("load-calibration");
+  load_calibration_command.add_description("Load a calibration file on the server");
+  load_calibration_command.add_argument("path").help("Path to the calibration file on the server");
+  argparse::ArgumentParser clear_calibration_command("clear-calibration");
+  clear_calibration_command.add_description("Remove all panel calibration");
+  argparse::ArgumentParser calibrate_tile_command("calibrate-tile");
+  calibrate_tile_command.add_description("Set the gain and gamma of one tile");
+  calibrate_tile_command.add_argument("x").help("Tile column").scan<'i', int>();
+  calibrate_tile_command.add_argument("y").help("Tile row").scan<'i', int>();
+  calibrate_tile_command.add_argument("--gain")
+      .help("Red, green and blue gain")
+      .nargs(3)
+      .default_value(std::vector<double>{1.0, 1.0, 1.0})
+      .scan<'g', double>();
+  calibrate_tile_command.add_argument("--gamma")
+      .help("Red, green and blue gamma")
+      .nargs(3)
+      .default_value(std::vector<double>{1.0, 1.0, 1.0})
+      .scan<'g', double>();
+  argparse::ArgumentParser get_calibration_command("get-calibration");
+  get_calibration_command.add_description("Get the calibration tile size and count");
+
   program.add_subparser(get_brightness_command);
   program.add_subparser(set_brightness_command);
   program.add_subparser(get_temperature_command);
   program.add_subparser(set_temperature_command);
+  program.add_subparser(fade_brightness_command);
+  program.add_subparser(fade_temperature_command);
   program.add_subparser(get_configuration_command);
+  program.add_subparser(get_stats_command);
+  program.add_subparser(load_clip_command);
+  program.add_subparser(clip_play_command);
+  program.add_subparser(clip_pause_command);
+  program.add_subparser(clip_stop_command);
+  program.add_subparser(clip_seek_command);
+  program.add_subparser(clip_rate_command);
+  program.add_subparser(clip_loop_command);
+  program.add_subparser(clip_status_command);
+  program.add_subparser(load_calibration_command);
+  program.add_subparser(clear_calibration_command);
+  program.add_subparser(calibrate_tile_command);
+  program.add_subparser(get_calibration_command);
 
+  lmz::Easing easing = lmz::Easing::Linear;
   try {
     program.parse_args(argc, argv);
+
+    for (const auto *command : {&fade_brightness_command, &fade_temperature_command}) {
+      if (!program.is_subcommand_used(*command)) {
+        continue;
+      }
+
+      const auto name = command->get<std::string>("--easing");
+      const auto parsed = easing::from_name(name);
+      if (!parsed) {
+        throw std::runtime_error("Invalid easing: " + name);
+      }
+      easing = *parsed;
+    }
   } catch (const std::runtime_error &err) {
     std::cerr << err.what() << std::endl;
     std::cerr << program;
@@ -91,6 +228,30 @@ int main(int argc, char *argv[]) {
         .args = {.temperature = static_cast<uint16_t>(temperature)},
     };
 
+    send_and_recv(sock, control_req);
+  } else if (program.is_subcommand_used(fade_brightness_command)) {
+    const auto brightness = fade_brightness_command.get<int>("brightness");
+    const auto duration = fade_brightness_command.get<int>("duration");
+    PLOG_INFO << "Fading brightness to " << brightness << " over " << duration << "ms";
+
+    const lmz::FadeBrightnessRequest control_req = {
+        .args = {.brightness = static_cast<uint8_t>(brightness),
+                 .duration_ms = static_cast<uint32_t>(duration),
+                 .easing = easing},
+    };
+
+    send_and_recv(sock, control_req);
+  } else if (program.is_subcommand_used(fade_temperature_command)) {
+    const auto temperature = fade_temperature_command.get<int>("temperature");
+    const auto duration = fade_temperature_command.get<int>("duration");
+    PLOG_INFO << "Fading temperature to " << temperature << "K over " << duration << "ms";
+
+    const lmz::FadeTemperatureRequest control_req = {
+        .args = {.temperature = static_cast<uint16_t>(temperature),
+                 .duration_ms = static_cast<uint32_t>(duration),
+                 .easing = easing},
+    };
+
     send_and_recv(sock, control_req);
   } else if (program.is_subcommand_used(get_brightness_command)) {
     const auto resp_msg = send_and_recv(sock, lmz::GetBrightnessRequest{});
@@ -105,6 +266,93 @@ int main(int argc, char *argv[]) {
 
     std::cout << std::to_string(res_msg.args.width) << " " << std::to_string(res_msg.args.height)
               << std::endl;
+  } else if (program.is_subcommand_used(get_stats_command)) {
+    const lmz::GetStatsRequest control_req = {
+        .args = {.reset = static_cast<uint8_t>(get_stats_command.get<bool>("--reset"))},
+    };
+    const auto res_msg = send_and_recv(sock, control_req);
+    const auto &args = res_msg.args;
+
+    std::cout << "frames_received " << args.frames_received << std::endl;
+    std::cout << "frames_rendered " << args.frames_rendered << std::endl;
+    std::cout << "frames_rejected " << args.frames_rejected << std::endl;
+    std::cout << "frames_dropped " << args.frames_dropped << std::endl;
+    std::cout << "frames_skipped " << args.frames_skipped << std::endl;
+    std::cout << "bytes_in " << args.bytes_in << std::endl;
+    std::cout << "control_requests " << args.control_requests << std::endl;
+    std::cout << "redraws_coalesced " << args.redraws_coalesced << std::endl;
+    std::cout << "frames_synced " << args.frames_synced << std::endl;
+    std::cout << "sync_missed " << args.sync_missed << std::endl;
+    std::cout << "sync_timeouts " << args.sync_timeouts << std::endl;
+    std::cout << "cache_hits " << args.cache_hits << std::endl;
+    std::cout << "cache_misses " << args.cache_misses << std::endl;
+    if (args.allocations_counted) {
+      std::cout << "frame_path_allocations " << args.frame_path_allocations << std::endl;
+    }
+    if (const auto lookups = args.cache_hits + args.cache_misses; lookups > 0) {
+      std::cout << "cache_hit_percent " << 100.0 * args.cache_hits / lookups << std::endl;
+    }
+    print_histogram("display_latency", stats::copy_from_message(args.display_latency_us));
+    print_histogram("render_time", stats::copy_from_message(args.render_time_us));
+    print_histogram("sync_skew", stats::copy_from_message(args.sync_skew_us));
+  } else if (program.is_subcommand_used(load_clip_command)) {
+    const auto path = load_clip_command.get<std::string>("path");
+    lmz::LoadClipRequest control_req = {
+        .args = {.path = {}, .loop = !load_clip_command.get<bool>("--no-loop")},
+    };
+    if (path.size() >= sizeof(control_req.args.path)) {
+      std::cerr << "Clip path is too long" << std::endl;
+      return 1;
+    }
+    path.copy(control_req.args.path, path.size());
+
+    print_clip_status(send_and_recv(sock, control_req).args);
+  } else if (program.is_subcommand_used(clip_play_command)) {
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::Play)).args);
+  } else if (program.is_subcommand_used(clip_pause_command)) {
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::Pause)).args);
+  } else if (program.is_subcommand_used(clip_stop_command)) {
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::Stop)).args);
+  } else if (program.is_subcommand_used(clip_seek_command)) {
+    const auto frame = clip_seek_command.get<int>("frame");
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::Seek, frame)).args);
+  } else if (program.is_subcommand_used(clip_rate_command)) {
+    const auto percent = clip_rate_command.get<int>("percent");
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::SetRate, percent)).args);
+  } else if (program.is_subcommand_used(clip_loop_command)) {
+    const auto loop = clip_loop_command.get<int>("loop");
+    print_clip_status(send_and_recv(sock, clip_control(lmz::ClipAction::SetLoop, loop)).args);
+  } else if (program.is_subcommand_used(clip_status_command)) {
+    print_clip_status(send_and_recv(sock, lmz::GetClipStatusRequest{}).args);
+  } else if (program.is_subcommand_used(load_calibration_command)) {
+    const auto path = load_calibration_command.get<std::string>("path");
+    lmz::LoadCalibrationRequest control_req = {.args = {.path = {}}};
+    if (path.empty() || path.size() >= sizeof(control_req.args.path)) {
+      std::cerr << "Calibration path is empty or too long" << std::endl;
+      return 1;
+    }
+    path.copy(control_req.args.path, path.size());
+
+    print_calibration(send_and_recv(sock, control_req).args);
+  } else if (program.is_subcommand_used(clear_calibration_command)) {
+    print_calibration(send_and_recv(sock, lmz::LoadCalibrationRequest{.args = {.path = {}}}).args);
+  } else if (program.is_subcommand_used(calibrate_tile_command)) {
+    const auto gain = calibrate_tile_command.get<std::vector<double>>("--gain");
+    const auto gamma = calibrate_tile_command.get<std::vector<double>>("--gamma");
+    const auto to_units = [](double value) {
+      return static_cast<uint16_t>(std::clamp(value * lmz::calibration_unit, 0.0, 65535.0));
+    };
+
+    lmz::SetTileCalibrationRequest control_req = {
+        .args = {.x = static_cast<uint16_t>(calibrate_tile_command.get<int>("x")),
+                 .y = static_cast<uint16_t>(calibrate_tile_command.get<int>("y")),
+                 .gain = {to_units(gain[0]), to_units(gain[1]), to_units(gain[2])},
+                 .gamma = {to_units(gamma[0]), to_units(gamma[1]), to_units(gamma[2])}},
+    };
+
+    print_calibration(send_and_recv(sock, control_req).args);
+  } else if (program.is_subcommand_used(get_calibration_command)) {
+    print_calibration(send_and_recv(sock, lmz::GetCalibrationRequest{}).args);
   } else {
     std::cerr << program;
     return 1;
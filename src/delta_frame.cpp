@@ -0,0 +1,133 @@
+#include "delta_frame.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "consts.hpp"
+#include "frame_messages.hpp"
+
+namespace {
+
+// Rows are diffed in bands of this many, with one rectangle covering the changes in each band.
+constexpr int band_rows = 8;
+
+template <typename T> void append_struct(std::vector<std::byte> &out, const T &value) {
+  const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// Walks the whole message without touching the frame, so a bad rectangle anywhere rejects it
+// before anything is patched.
+void validate(std::span<const std::byte> message, int width, int height) {
+  const auto header = lmz::read_frame_struct<lmz::DeltaFrameHeader>(message);
+
+  for (auto i = 0; i < header.rect_count; ++i) {
+    const auto rect = lmz::read_frame_struct<lmz::DeltaRect>(message);
+    if (rect.x + rect.width > width || rect.y + rect.height > height) {
+      throw std::runtime_error("Received delta rectangle outside of the frame");
+    }
+
+    const auto rect_size = std::size_t{rect.width} * rect.height * consts::pixel_size;
+    if (message.size() < rect_size) {
+      throw std::runtime_error("Received truncated frame message");
+    }
+    message = message.subspan(rect_size);
+  }
+
+  if (!message.empty()) {
+    throw std::runtime_error("Received delta frame with trailing data");
+  }
+}
+
+} // namespace
+
+bool delta_frame::apply(std::span<const std::byte> message, std::span<std::byte> frame, int width,
+                        int height) {
+  validate(message, width, height);
+
+  const auto header = lmz::read_frame_struct<lmz::DeltaFrameHeader>(message);
+  auto changed = false;
+
+  for (auto i = 0; i < header.rect_count; ++i) {
+    const auto rect = lmz::read_frame_struct<lmz::DeltaRect>(message);
+    const auto row_size = rect.width * consts::pixel_size;
+
+    for (auto y = 0; y < rect.height; ++y) {
+      auto *row = frame.data() + ((rect.y + y) * width + rect.x) * consts::pixel_size;
+      if (std::memcmp(row, message.data(), row_size) != 0) {
+        std::memcpy(row, message.data(), row_size);
+        changed = true;
+      }
+      message = message.subspan(row_size);
+    }
+  }
+
+  return changed;
+}
+
+bool delta_frame::encode(std::span<const std::byte> previous, std::span<const std::byte> current,
+                         int width, int height, std::vector<std::byte> &out) {
+  const auto frame_size = current.size();
+  const auto row_size = width * consts::pixel_size;
+
+  out.clear();
+  append_struct(out, lmz::DeltaFrameHeader{.rect_count = 0});
+  std::uint16_t rect_count = 0;
+
+  for (auto band_y = 0; band_y < height; band_y += band_rows) {
+    const auto band_end = std::min(band_y + band_rows, height);
+    auto min_x = width, max_x = -1, min_y = height, max_y = -1;
+
+    for (auto y = band_y; y < band_end; ++y) {
+      const auto *prev_row = previous.data() + y * row_size;
+      const auto *cur_row = current.data() + y * row_size;
+      if (std::memcmp(prev_row, cur_row, row_size) == 0) {
+        continue;
+      }
+
+      auto first = 0;
+      while (std::memcmp(prev_row + first * consts::pixel_size,
+                         cur_row + first * consts::pixel_size, consts::pixel_size) == 0) {
+        ++first;
+      }
+
+      auto last = width - 1;
+      while (std::memcmp(prev_row + last * consts::pixel_size, cur_row + last * consts::pixel_size,
+                         consts::pixel_size) == 0) {
+        --last;
+      }
+
+      min_x = std::min(min_x, first);
+      max_x = std::max(max_x, last);
+      min_y = std::min(min_y, y);
+      max_y = y;
+    }
+
+    if (max_y < 0) {
+      continue;
+    }
+
+    const auto rect = lmz::DeltaRect{
+        .x = static_cast<std::uint16_t>(min_x),
+        .y = static_cast<std::uint16_t>(min_y),
+        .width = static_cast<std::uint16_t>(max_x - min_x + 1),
+        .height = static_cast<std::uint16_t>(max_y - min_y + 1),
+    };
+
+    append_struct(out, rect);
+    for (auto y = min_y; y <= max_y; ++y) {
+      const auto *start = current.data() + y * row_size + min_x * consts::pixel_size;
+      out.insert(out.end(), start, start + rect.width * consts::pixel_size);
+    }
+
+    ++rect_count;
+    if (out.size() >= frame_size) {
+      return false;
+    }
+  }
+
+  std::memcpy(out.data() + offsetof(lmz::DeltaFrameHeader, rect_count), &rect_count,
+              sizeof(rect_count));
+  return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Dirty-rectangle frames: only the regions that changed since the previous frame are sent, and
+// the server patches them into its current frame.
+namespace delta_frame {
+
+// Patches every rectangle in a delta frame message into `frame`. Returns true if that changed any
+// pixel. Throws std::runtime_error, leaving `frame` alone, if the message is malformed or a
+// rectangle falls outside the frame.
+bool apply(std::span<const std::byte> message, std::span<std::byte> frame, int width, int height);
+
+// Writes a delta frame message turning `previous` into `current` to `out`. Returns false, leaving
+// `out` in an unspecified state, when the delta would be no smaller than the full frame.
+bool encode(std::span<const std::byte> previous, std::span<const std::byte> current, int width,
+            int height, std::vector<std::byte> &out);
+
+} // namespace delta_frame
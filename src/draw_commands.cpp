@@ -0,0 +1,367 @@
+#include "draw_commands.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "consts.hpp"
+
+namespace {
+
+struct Target {
+  std::uint32_t *pixels;
+  int width;
+  int height;
+
+  void plot(int x, int y, std::uint32_t color) const {
+    if (x >= 0 && x < width && y >= 0 && y < height) {
+      pixels[y * width + x] = color;
+    }
+  }
+};
+
+void fill_rect(const Target &target, const lmz::FillRectCommand &command) {
+  const auto x0 = std::max<int>(command.x, 0);
+  const auto y0 = std::max<int>(command.y, 0);
+  const auto x1 = std::min(command.x + command.width, target.width);
+  const auto y1 = std::min(command.y + command.height, target.height);
+  if (x0 >= x1) {
+    return;
+  }
+
+  for (auto y = y0; y < y1; ++y) {
+    std::fill(target.pixels + y * target.width + x0, target.pixels + y * target.width + x1,
+              command.color);
+  }
+}
+
+// Cohen-Sutherland region codes of a point against the frame.
+constexpr int outside_left = 1, outside_right = 2, outside_top = 4, outside_bottom = 8;
+
+int outcode(const Target &target, double x, double y) {
+  auto code = 0;
+  if (x < 0) {
+    code |= outside_left;
+  } else if (x > target.width - 1) {
+    code |= outside_right;
+  }
+  if (y < 0) {
+    code |= outside_top;
+  } else if (y > target.height - 1) {
+    code |= outside_bottom;
+  }
+  return code;
+}
+
+// Cohen-Sutherland, moving the ends of the line onto the frame's edges. Returns false if none of
+// the line is inside the frame.
+bool clip_line(const Target &target, double &x0, double &y0, double &x1, double &y1) {
+  const double right = target.width - 1, bottom = target.height - 1;
+  auto code0 = outcode(target, x0, y0), code1 = outcode(target, x1, y1);
+  while (true) {
+    if ((code0 | code1) == 0) {
+      return true;
+    }
+    if ((code0 & code1) != 0) {
+      return false;
+    }
+
+    // An end outside an edge means the other one isn't, so the divisions are safe.
+    const auto code = code0 != 0 ? code0 : code1;
+    double x, y;
+    if (code & outside_bottom) {
+      x = x0 + (x1 - x0) * (bottom - y0) / (y1 - y0);
+      y = bottom;
+    } else if (code & outside_top) {
+      x = x0 + (x1 - x0) * -y0 / (y1 - y0);
+      y = 0;
+    } else if (code & outside_right) {
+      y = y0 + (y1 - y0) * (right - x0) / (x1 - x0);
+      x = right;
+    } else {
+      y = y0 + (y1 - y0) * -x0 / (x1 - x0);
+      x = 0;
+    }
+
+    if (code == code0) {
+      x0 = x;
+      y0 = y;
+      code0 = outcode(target, x0, y0);
+    } else {
+      x1 = x;
+      y1 = y;
+      code1 = outcode(target, x1, y1);
+    }
+  }
+}
+
+// Bresenham over the part of the line inside the frame, so a line far off it costs nothing.
+void line(const Target &target, const lmz::LineCommand &command) {
+  double clip_x0 = command.x0, clip_y0 = command.y0, clip_x1 = command.x1, clip_y1 = command.y1;
+  if (!clip_line(target, clip_x0, clip_y0, clip_x1, clip_y1)) {
+    return;
+  }
+
+  int x = std::lround(clip_x0), y = std::lround(clip_y0);
+  const int end_x = std::lround(clip_x1), end_y = std::lround(clip_y1);
+  const int dx = std::abs(end_x - x), dy = -std::abs(end_y - y);
+  const int step_x = x < end_x ? 1 : -1, step_y = y < end_y ? 1 : -1;
+
+  auto error = dx + dy;
+  while (true) {
+    target.plot(x, y, command.color);
+    if (x == end_x && y == end_y) {
+      return;
+    }
+
+    const auto error2 = 2 * error;
+    if (error2 >= dy) {
+      error += dy;
+      x += step_x;
+    }
+    if (error2 <= dx) {
+      error += dx;
+      y += step_y;
+    }
+  }
+}
+
+void blit(const Target &target, const lmz::BlitCommand &command,
+          const draw_commands::Atlas &atlas) {
+  if (command.src_x + command.width > atlas.width ||
+      command.src_y + command.height > atlas.height) {
+    throw std::runtime_error("Received blit from outside the sprite atlas");
+  }
+
+  // Only the part of the sprite that lands on the frame is visited.
+  const auto row_begin = std::max(0, -command.y);
+  const auto row_end = std::min<int>(command.height, target.height - command.y);
+  const auto column_begin = std::max(0, -command.x);
+  const auto column_end = std::min<int>(command.width, target.width - command.x);
+
+  for (auto row = row_begin; row < row_end; ++row) {
+    const auto y = command.y + row;
+    const auto *src = atlas.pixels.data() + (command.src_y + row) * atlas.width + command.src_x;
+    for (auto column = column_begin; column < column_end; ++column) {
+      if ((src[column] >> 24) != 0) {
+        target.plot(command.x + column, y, src[column]);
+      }
+    }
+  }
+}
+
+void text(const Target &target, const lmz::TextCommand &command, std::span<const std::byte> chars,
+          const draw_commands::Font &font) {
+  const auto row_bytes = (font.glyph_width + 7) / 8;
+  const auto glyph_bytes = row_bytes * font.glyph_height;
+
+  // Like blit(), glyphs are only visited where they overlap the frame.
+  const auto row_begin = std::max(0, -command.y);
+  const auto row_end = std::min(font.glyph_height, target.height - command.y);
+  if (row_begin >= row_end) {
+    return;
+  }
+
+  auto x = static_cast<int>(command.x);
+  for (const auto c : chars) {
+    if (x >= target.width) {
+      return;
+    }
+
+    const auto glyph = static_cast<int>(c) - font.first_char;
+    if (glyph >= 0 && glyph < font.glyph_count && x + font.glyph_width > 0) {
+      const auto *bitmap = font.bitmaps.data() + glyph * glyph_bytes;
+      const auto column_begin = std::max(0, -x);
+      const auto column_end = std::min(font.glyph_width, target.width - x);
+      for (auto row = row_begin; row < row_end; ++row) {
+        for (auto column = column_begin; column < column_end; ++column) {
+          if (bitmap[row * row_bytes + column / 8] & (0x80 >> (column % 8))) {
+            target.plot(x + column, command.y + row, command.color);
+          }
+        }
+      }
+    }
+
+    x += font.glyph_width;
+  }
+}
+
+} // namespace
+
+draw_commands::Atlas draw_commands::read_atlas(std::span<const std::byte> message) {
+  const auto header = lmz::read_frame_struct<lmz::AtlasFrameHeader>(message);
+  const auto pixels = message;
+  if (pixels.size() != header.width * header.height * consts::pixel_size) {
+    throw std::runtime_error("Received sprite atlas of unexpected size");
+  }
+
+  Atlas atlas{.width = header.width, .height = header.height, .pixels = {}};
+  atlas.pixels.resize(header.width * header.height);
+  std::memcpy(atlas.pixels.data(), pixels.data(), pixels.size());
+  return atlas;
+}
+
+draw_commands::Font draw_commands::read_font(std::span<const std::byte> message) {
+  const auto header = lmz::read_frame_struct<lmz::FontFrameHeader>(message);
+  const auto bitmaps = message;
+  const auto glyph_bytes = (header.glyph_width + 7) / 8 * header.glyph_height;
+  if (header.glyph_width == 0 || header.glyph_height == 0 ||
+      bitmaps.size() != static_cast<std::size_t>(glyph_bytes * header.glyph_count)) {
+    throw std::runtime_error("Received font of unexpected size");
+  }
+
+  const auto *data = reinterpret_cast<const std::uint8_t *>(bitmaps.data());
+  return Font{
+      .glyph_width = header.glyph_width,
+      .glyph_height = header.glyph_height,
+      .first_char = header.first_char,
+      .glyph_count = header.glyph_count,
+      .bitmaps = std::vector<std::uint8_t>(data, data + bitmaps.size()),
+  };
+}
+
+void draw_commands::draw(std::span<const std::byte> message, std::span<std::uint32_t> frame,
+                         int width, int height, const Atlas &atlas, const Font &font) {
+  const auto header = lmz::read_frame_struct<lmz::CommandsFrameHeader>(message);
+  const Target target = {.pixels = frame.data(), .width = width, .height = height};
+
+  for (auto i = 0; i < header.command_count; ++i) {
+    if (message.empty()) {
+      throw std::runtime_error("Received truncated frame message");
+    }
+
+    switch (static_cast<lmz::DrawCommandType>(message.front())) {
+    case lmz::DrawCommandType::FillRect: {
+      fill_rect(target, lmz::read_frame_struct<lmz::FillRectCommand>(message));
+    } break;
+    case lmz::DrawCommandType::Line: {
+      line(target, lmz::read_frame_struct<lmz::LineCommand>(message));
+    } break;
+    case lmz::DrawCommandType::Blit: {
+      blit(target, lmz::read_frame_struct<lmz::BlitCommand>(message), atlas);
+    } break;
+    case lmz::DrawCommandType::Text: {
+      const auto command = lmz::read_frame_struct<lmz::TextCommand>(message);
+      if (message.size() < command.length) {
+        throw std::runtime_error("Received truncated frame message");
+      }
+
+      text(target, command, message.first(command.length), font);
+      message = message.subspan(command.length);
+    } break;
+    default: {
+      throw std::runtime_error("Received unknown draw command");
+    }
+    }
+  }
+
+  if (!message.empty()) {
+    throw std::runtime_error("Received draw commands with trailing data");
+  }
+}
+
+namespace {
+
+template <typename T> void append_struct(std::vector<std::byte> &out, const T &value) {
+  const auto offset = out.size();
+  out.resize(offset + sizeof(value));
+  std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+template <typename T> std::vector<std::byte> upload_message(const T &header,
+                                                            std::span<const std::byte> body) {
+  std::vector<std::byte> message(sizeof(header) + body.size());
+  std::memcpy(message.data(), &header, sizeof(header));
+  std::memcpy(message.data() + sizeof(header), body.data(), body.size());
+  return message;
+}
+
+} // namespace
+
+draw_commands::CommandList::CommandList() { clear(); }
+
+void draw_commands::CommandList::clear() {
+  bytes.clear();
+  append_struct(bytes, lmz::CommandsFrameHeader{.command_count = 0});
+}
+
+template <typename T> void draw_commands::CommandList::append(const T &command) {
+  append_struct(bytes, command);
+
+  auto header = lmz::CommandsFrameHeader{};
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  header.command_count++;
+  std::memcpy(bytes.data(), &header, sizeof(header));
+}
+
+void draw_commands::CommandList::fill_rect(int x, int y, int width, int height,
+                                           std::uint32_t color) {
+  append(lmz::FillRectCommand{
+      .x = static_cast<std::int16_t>(x),
+      .y = static_cast<std::int16_t>(y),
+      .width = static_cast<std::uint16_t>(width),
+      .height = static_cast<std::uint16_t>(height),
+      .color = color,
+  });
+}
+
+void draw_commands::CommandList::line(int x0, int y0, int x1, int y1, std::uint32_t color) {
+  append(lmz::LineCommand{
+      .x0 = static_cast<std::int16_t>(x0),
+      .y0 = static_cast<std::int16_t>(y0),
+      .x1 = static_cast<std::int16_t>(x1),
+      .y1 = static_cast<std::int16_t>(y1),
+      .color = color,
+  });
+}
+
+void draw_commands::CommandList::blit(int src_x, int src_y, int width, int height, int x, int y) {
+  append(lmz::BlitCommand{
+      .src_x = static_cast<std::uint16_t>(src_x),
+      .src_y = static_cast<std::uint16_t>(src_y),
+      .width = static_cast<std::uint16_t>(width),
+      .height = static_cast<std::uint16_t>(height),
+      .x = static_cast<std::int16_t>(x),
+      .y = static_cast<std::int16_t>(y),
+  });
+}
+
+void draw_commands::CommandList::text(int x, int y, std::uint32_t color,
+                                      std::string_view string) {
+  string = string.substr(0, 255);
+  append(lmz::TextCommand{
+      .x = static_cast<std::int16_t>(x),
+      .y = static_cast<std::int16_t>(y),
+      .color = color,
+      .length = static_cast<std::uint8_t>(string.size()),
+  });
+
+  const auto *chars = reinterpret_cast<const std::byte *>(string.data());
+  bytes.insert(bytes.end(), chars, chars + string.size());
+}
+
+std::vector<std::byte> draw_commands::atlas_message(int width, int height,
+                                                    std::span<const std::uint32_t> pixels) {
+  const lmz::AtlasFrameHeader header = {
+      .width = static_cast<std::uint16_t>(width),
+      .height = static_cast<std::uint16_t>(height),
+  };
+  return upload_message(header, std::as_bytes(pixels));
+}
+
+std::vector<std::byte> draw_commands::font_message(int glyph_width, int glyph_height,
+                                                   int first_char,
+                                                   std::span<const std::uint8_t> bitmaps) {
+  const auto glyph_bytes = static_cast<std::size_t>((glyph_width + 7) / 8 * glyph_height);
+  const auto glyph_count = std::min<std::size_t>(bitmaps.size() / glyph_bytes, 255);
+
+  const lmz::FontFrameHeader header = {
+      .glyph_width = static_cast<std::uint8_t>(glyph_width),
+      .glyph_height = static_cast<std::uint8_t>(glyph_height),
+      .first_char = static_cast<std::uint8_t>(first_char),
+      .glyph_count = static_cast<std::uint8_t>(glyph_count),
+  };
+  return upload_message(header, std::as_bytes(bitmaps.first(glyph_count * glyph_bytes)));
+}
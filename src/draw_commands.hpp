@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "frame_messages.hpp"
+
+// Frames described as a list of draw commands (rectangles, lines, sprites, text) that the server
+// rasterizes itself, for UI-style content where a few numbers change between frames.
+namespace draw_commands {
+
+// Uploaded with an Atlas frame message.
+struct Atlas {
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint32_t> pixels;
+};
+
+// Uploaded with a Font frame message. Bitmaps are laid out as in the message.
+struct Font {
+  int glyph_width = 0;
+  int glyph_height = 0;
+  int first_char = 0;
+  int glyph_count = 0;
+  std::vector<std::uint8_t> bitmaps;
+};
+
+// Read an Atlas or Font message. Throw std::runtime_error if the message is malformed.
+Atlas read_atlas(std::span<const std::byte> message);
+Font read_font(std::span<const std::byte> message);
+
+// Draws the commands of a Commands frame message onto an RGBA32 frame. Throws
+// std::runtime_error if the message is malformed, leaving whatever was drawn so far.
+void draw(std::span<const std::byte> message, std::span<std::uint32_t> frame, int width,
+          int height, const Atlas &atlas, const Font &font);
+
+// Builds a Commands frame message.
+class CommandList {
+public:
+  CommandList();
+
+  void fill_rect(int x, int y, int width, int height, std::uint32_t color);
+  void line(int x0, int y0, int x1, int y1, std::uint32_t color);
+  void blit(int src_x, int src_y, int width, int height, int x, int y);
+
+  // Text longer than 255 characters is cut short.
+  void text(int x, int y, std::uint32_t color, std::string_view string);
+
+  // Starts a new list.
+  void clear();
+
+  std::span<const std::byte> message() const { return bytes; }
+
+private:
+  template <typename T> void append(const T &command);
+
+  std::vector<std::byte> bytes;
+};
+
+// Build Atlas and Font messages. Fonts of more than 255 glyphs are cut short.
+std::vector<std::byte> atlas_message(int width, int height, std::span<const std::uint32_t> pixels);
+std::vector<std::byte> font_message(int glyph_width, int glyph_height, int first_char,
+                                    std::span<const std::uint8_t> bitmaps);
+
+} // namespace draw_commands
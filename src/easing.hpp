@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+
+#include "messages.hpp"
+
+namespace easing {
+
+// Maps linear progress `t` (0-1) onto eased progress (0-1).
+inline double apply(lmz::Easing curve, double t) {
+  t = std::clamp(t, 0.0, 1.0);
+
+  switch (curve) {
+  case lmz::Easing::EaseIn:
+    return t * t;
+  case lmz::Easing::EaseOut:
+    return t * (2 - t);
+  case lmz::Easing::EaseInOut:
+    return t * t * (3 - 2 * t);
+  case lmz::Easing::Linear:
+  default:
+    return t;
+  }
+}
+
+inline std::optional<lmz::Easing> from_name(const std::string &name) {
+  if (name == "linear") {
+    return lmz::Easing::Linear;
+  } else if (name == "ease-in") {
+    return lmz::Easing::EaseIn;
+  } else if (name == "ease-out") {
+    return lmz::Easing::EaseOut;
+  } else if (name == "ease-in-out") {
+    return lmz::Easing::EaseInOut;
+  }
+
+  return std::nullopt;
+}
+
+} // namespace easing
@@ -0,0 +1,45 @@
+#include "frame_cache.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+lmz::FrameCache::FrameCache(std::size_t budget, std::size_t frame_size)
+    : max_entries(frame_size > 0 ? budget / frame_size : 0), frame_size(frame_size) {
+  index.reserve(max_entries);
+}
+
+std::optional<std::span<const std::byte>> lmz::FrameCache::find(const FrameHash &hash) {
+  const auto it = index.find(hash);
+  if (it == index.end()) {
+    return std::nullopt;
+  }
+
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->frame;
+}
+
+void lmz::FrameCache::insert(const FrameHash &hash, std::span<const std::byte> frame) {
+  if (max_entries == 0) {
+    return;
+  }
+
+  if (const auto it = index.find(hash); it != index.end()) {
+    entries.splice(entries.begin(), entries, it->second);
+    std::copy(frame.begin(), frame.end(), it->second->frame.begin());
+    return;
+  }
+
+  if (entries.size() < max_entries) {
+    entries.push_front({.hash = hash, .frame = std::vector<std::byte>(frame_size)});
+    index.emplace(hash, entries.begin());
+  } else {
+    // Move the least recently used entry and its index node over to the new hash.
+    entries.splice(entries.begin(), entries, std::prev(entries.end()));
+    auto node = index.extract(entries.front().hash);
+    node.key() = hash;
+    index.insert(std::move(node));
+    entries.front().hash = hash;
+  }
+
+  std::copy(frame.begin(), frame.end(), entries.front().frame.begin());
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "frame_messages.hpp"
+
+namespace lmz {
+
+// Recently shown frames by content hash, evicting the least recently used ones to stay within a
+// byte budget. Once full, new frames reuse the storage of evicted ones, so it stops allocating.
+class FrameCache {
+public:
+  // Holds as many frames of `frame_size` bytes as fit in `budget` bytes, possibly none.
+  FrameCache(std::size_t budget, std::size_t frame_size);
+
+  // The frame cached under `hash`, now the most recently used. Valid until the next insert().
+  std::optional<std::span<const std::byte>> find(const FrameHash &hash);
+
+  // Caches `frame` under `hash`, replacing whatever was cached under it before.
+  void insert(const FrameHash &hash, std::span<const std::byte> frame);
+
+  std::size_t size() const { return entries.size(); }
+  std::size_t capacity() const { return max_entries; }
+
+private:
+  struct Entry {
+    FrameHash hash;
+    std::vector<std::byte> frame;
+  };
+
+  // Hashes are already uniformly distributed, so any bytes of them will do.
+  struct HashKey {
+    std::size_t operator()(const FrameHash &hash) const {
+      std::size_t key;
+      std::memcpy(&key, hash.data(), sizeof(key));
+      return key;
+    }
+  };
+
+  std::size_t max_entries;
+  std::size_t frame_size;
+
+  // Most recently used first.
+  std::list<Entry> entries;
+  std::unordered_map<FrameHash, std::list<Entry>::iterator, HashKey> index;
+};
+
+} // namespace lmz
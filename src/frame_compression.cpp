@@ -0,0 +1,151 @@
+#include "frame_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t min_match = 4;
+constexpr std::size_t max_offset = 0xFFFF;
+constexpr int hash_bits = 12;
+
+std::uint32_t read_u32(const std::byte *ptr) {
+  std::uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(std::uint32_t value) { return (value * 2654435761u) >> (32 - hash_bits); }
+
+void write_length(std::vector<std::byte> &out, std::size_t length) {
+  for (; length >= 255; length -= 255) {
+    out.push_back(std::byte{255});
+  }
+  out.push_back(static_cast<std::byte>(length));
+}
+
+void write_sequence(std::vector<std::byte> &out, std::span<const std::byte> literals,
+                    std::size_t match_length, std::size_t offset) {
+  const auto literal_nibble = std::min<std::size_t>(literals.size(), 15);
+  const auto match_nibble = match_length ? std::min<std::size_t>(match_length - min_match, 15) : 0;
+  out.push_back(static_cast<std::byte>((literal_nibble << 4) | match_nibble));
+
+  if (literal_nibble == 15) {
+    write_length(out, literals.size() - 15);
+  }
+  out.insert(out.end(), literals.begin(), literals.end());
+
+  if (match_length == 0) {
+    return;
+  }
+
+  out.push_back(static_cast<std::byte>(offset & 0xFF));
+  out.push_back(static_cast<std::byte>(offset >> 8));
+  if (match_nibble == 15) {
+    write_length(out, match_length - min_match - 15);
+  }
+}
+
+std::size_t read_length(std::span<const std::byte> src, std::size_t &pos, std::size_t nibble) {
+  auto length = nibble;
+  if (nibble != 15) {
+    return length;
+  }
+
+  while (true) {
+    if (pos >= src.size()) {
+      throw std::runtime_error("Received truncated compressed frame");
+    }
+
+    const auto byte = static_cast<std::size_t>(src[pos++]);
+    length += byte;
+    if (byte != 255) {
+      return length;
+    }
+  }
+}
+
+} // namespace
+
+void frame_compression::compress(std::span<const std::byte> src, std::vector<std::byte> &out) {
+  std::array<std::uint32_t, 1 << hash_bits> table;
+  table.fill(0);
+
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+
+  while (pos + min_match <= src.size()) {
+    const auto value = read_u32(src.data() + pos);
+    auto &entry = table[hash(value)];
+    const std::size_t candidate = entry;
+    entry = static_cast<std::uint32_t>(pos);
+
+    if (candidate >= pos || pos - candidate > max_offset ||
+        read_u32(src.data() + candidate) != value) {
+      ++pos;
+      continue;
+    }
+
+    auto length = min_match;
+    while (pos + length < src.size() && src[candidate + length] == src[pos + length]) {
+      ++length;
+    }
+
+    write_sequence(out, src.subspan(anchor, pos - anchor), length, pos - candidate);
+    pos += length;
+    anchor = pos;
+  }
+
+  write_sequence(out, src.subspan(anchor), 0, 0);
+}
+
+void frame_compression::decompress(std::span<const std::byte> src, std::span<std::byte> dst) {
+  std::size_t pos = 0;
+  std::size_t out = 0;
+
+  while (pos < src.size()) {
+    const auto token = static_cast<std::size_t>(src[pos++]);
+
+    const auto literal_length = read_length(src, pos, token >> 4);
+    if (literal_length > src.size() - pos || literal_length > dst.size() - out) {
+      throw std::runtime_error("Received compressed frame with out of bounds literals");
+    }
+    std::copy_n(src.data() + pos, literal_length, dst.data() + out);
+    pos += literal_length;
+    out += literal_length;
+
+    if (pos == src.size()) {
+      break;
+    }
+
+    if (src.size() - pos < 2) {
+      throw std::runtime_error("Received truncated compressed frame");
+    }
+    const auto offset = static_cast<std::size_t>(src[pos]) |
+                        (static_cast<std::size_t>(src[pos + 1]) << 8);
+    pos += 2;
+
+    const auto match_length = read_length(src, pos, token & 0x0F) + min_match;
+    if (offset == 0 || offset > out || match_length > dst.size() - out) {
+      throw std::runtime_error("Received compressed frame with out of bounds match");
+    }
+
+    // Matches may overlap their own output (e.g. a run of one pixel). The repeating pattern
+    // doubles in length with every copy, so long runs still only take a few memcpys.
+    const auto *from = dst.data() + out - offset;
+    auto *to = dst.data() + out;
+    for (std::size_t copied = 0; copied < match_length;) {
+      const auto chunk = std::min(offset + copied, match_length - copied);
+      std::memcpy(to + copied, from, chunk);
+      copied += chunk;
+    }
+    out += match_length;
+  }
+
+  if (out != dst.size()) {
+    throw std::runtime_error("Received compressed frame of unexpected size");
+  }
+}
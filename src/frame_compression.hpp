@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// A small LZ77 codec in the spirit of LZ4, meant for frames that are mostly flat color. Each
+// sequence is a token byte (literal count in the high nibble, match length - 4 in the low
+// nibble, 15 meaning more length bytes follow), the literals, then a 16-bit little endian match
+// offset. The last sequence has literals only.
+namespace frame_compression {
+
+// Appends the compressed form of `src` to `out`.
+void compress(std::span<const std::byte> src, std::vector<std::byte> &out);
+
+// Decompresses `src` into `dst`, which must be exactly the uncompressed size. Throws
+// std::runtime_error if the data is malformed or doesn't fill `dst` exactly.
+void decompress(std::span<const std::byte> src, std::span<std::byte> dst);
+
+} // namespace frame_compression
@@ -0,0 +1,139 @@
+#include "frame_decoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "consts.hpp"
+#include "delta_frame.hpp"
+#include "frame_compression.hpp"
+#include "frame_hash.hpp"
+#include "frame_messages.hpp"
+
+lmz::FrameDecoder::FrameDecoder(int width, int height, std::size_t cache_budget)
+    : width(width), height(height), frame_size(width * height * consts::pixel_size),
+      palette(pixel_format::default_palette()), cache(cache_budget, frame_size),
+      decompressed(frame_size * consts::max_frame_message_factor), decoded(width * height) {}
+
+namespace {
+
+lmz::FrameDecoder::Result replace_frame(const std::byte *src, std::span<std::byte> frame) {
+  if (std::memcmp(src, frame.data(), frame.size()) == 0) {
+    return lmz::FrameDecoder::Result::Unchanged;
+  }
+
+  std::memcpy(frame.data(), src, frame.size());
+  return lmz::FrameDecoder::Result::Changed;
+}
+
+} // namespace
+
+lmz::FrameDecoder::Result lmz::FrameDecoder::decode(std::span<const std::byte> message,
+                                                    std::span<std::byte> frame) {
+  last_sequence.reset();
+  last_cache_hit.reset();
+  in_compressed = false;
+  in_cacheable = false;
+  return decode_message(message, frame);
+}
+
+lmz::FrameDecoder::Result lmz::FrameDecoder::decode_message(std::span<const std::byte> message,
+                                                            std::span<std::byte> frame) {
+  if (message.size() == frame_size) {
+    return replace_frame(message.data(), frame);
+  }
+
+  switch (get_frame_type_from_data(message)) {
+  case FrameType::Delta: {
+    return delta_frame::apply(message, frame, width, height) ? Result::Changed : Result::Unchanged;
+  }
+  case FrameType::Pixels: {
+    const auto header = read_frame_struct<PixelsFrameHeader>(message);
+    pixel_format::decode(header.format, message, decoded.data(), width * height, palette);
+    return replace_frame(reinterpret_cast<const std::byte *>(decoded.data()), frame);
+  }
+  case FrameType::Palette: {
+    const auto header = read_frame_struct<PaletteFrameHeader>(message);
+    if (header.entry_count > palette.size() || message.size() != header.entry_count * 3u) {
+      throw std::runtime_error("Received palette of unexpected size");
+    }
+
+    for (auto i = 0; i < header.entry_count; ++i) {
+      const auto *rgb = reinterpret_cast<const std::uint8_t *>(message.data()) + i * 3;
+      palette[i] = (rgb[0] << 0) | (rgb[1] << 8) | (rgb[2] << 16);
+    }
+    return Result::NoFrame;
+  }
+  case FrameType::Compressed: {
+    const auto header = read_frame_struct<CompressedFrameHeader>(message);
+    // The inner message lives in `decompressed`, so nothing in it may decompress into it again.
+    if (in_compressed) {
+      throw std::runtime_error("Received nested compressed frame");
+    }
+    if (header.compression != Compression::Lz) {
+      throw std::runtime_error("Received frame with unknown compression");
+    }
+    if (header.size > decompressed.size()) {
+      throw std::runtime_error("Received compressed frame that is too large");
+    }
+
+    const auto inner = std::span<std::byte>(decompressed.data(), header.size);
+    frame_compression::decompress(message, inner);
+    in_compressed = true;
+
+    return decode_message(inner, frame);
+  }
+  case FrameType::Commands: {
+    // Drawn on a copy, so an unchanged result can be told apart and a bad command leaves the
+    // frame alone.
+    const auto *pixels = reinterpret_cast<const std::uint32_t *>(frame.data());
+    std::copy(pixels, pixels + width * height, decoded.begin());
+    draw_commands::draw(message, decoded, width, height, atlas, font);
+    return replace_frame(reinterpret_cast<const std::byte *>(decoded.data()), frame);
+  }
+  case FrameType::Atlas: {
+    atlas = draw_commands::read_atlas(message);
+    return Result::NoFrame;
+  }
+  case FrameType::Font: {
+    font = draw_commands::read_font(message);
+    return Result::NoFrame;
+  }
+  case FrameType::Cached: {
+    const auto header = read_frame_struct<CachedFrameHeader>(message);
+    if (!message.empty() || in_cacheable) {
+      throw std::runtime_error("Received malformed cached frame");
+    }
+
+    const auto cached = cache.find(header.hash);
+    last_cache_hit = cached.has_value();
+    return cached ? replace_frame(cached->data(), frame) : Result::NoFrame;
+  }
+  case FrameType::Cacheable: {
+    const auto header = read_frame_struct<CacheableFrameHeader>(message);
+    if (in_cacheable) {
+      throw std::runtime_error("Received nested cacheable frame");
+    }
+
+    // Only cached under a hash that matches, so no producer can put a frame under another's hash.
+    in_cacheable = true;
+    const auto result = decode_message(message, frame);
+    if (result != Result::NoFrame && cache.capacity() > 0 &&
+        frame_hash::hash(frame) == header.hash) {
+      cache.insert(header.hash, frame);
+    }
+    return result;
+  }
+  case FrameType::Sequenced: {
+    const auto header = read_frame_struct<SequencedFrameHeader>(message);
+    if (last_sequence) {
+      throw std::runtime_error("Received nested sequenced frame");
+    }
+
+    last_sequence = header.sequence;
+    return decode_message(message, frame);
+  }
+  }
+
+  throw std::runtime_error("Received frame message with invalid type");
+}
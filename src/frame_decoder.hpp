@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "draw_commands.hpp"
+#include "frame_cache.hpp"
+#include "pixel_format.hpp"
+
+namespace lmz {
+
+// Turns messages received on the frame endpoint into RGBA32 frames, keeping whatever state the
+// frame protocol needs between messages (e.g. the palette, sprite atlas, font and frame cache).
+class FrameDecoder {
+public:
+  enum class Result {
+    Changed,   // The frame has new content to show
+    Unchanged, // The message was a frame, but identical to the previous one
+    NoFrame,   // The message only updated decoder state
+  };
+
+  // Caches up to `cache_budget` bytes of frames for Cached frame messages to refer to.
+  FrameDecoder(int width, int height, std::size_t cache_budget = 0);
+
+  // Applies `message` to `frame`, which must hold the previous frame. An unchanged frame is left
+  // alone rather than copied over itself. Throws std::runtime_error for malformed messages,
+  // leaving `frame` as it was.
+  Result decode(std::span<const std::byte> message, std::span<std::byte> frame);
+
+  // The sequence number the last decoded message was wrapped in, if any.
+  std::optional<std::uint32_t> sequence() const { return last_sequence; }
+
+  // Whether the frame the last decoded message referred to was in the cache, if it referred to
+  // one. A miss leaves the frame alone and decodes as NoFrame.
+  std::optional<bool> cache_hit() const { return last_cache_hit; }
+
+private:
+  Result decode_message(std::span<const std::byte> message, std::span<std::byte> frame);
+
+  int width;
+  int height;
+  std::size_t frame_size;
+
+  pixel_format::Palette palette;
+  draw_commands::Atlas atlas;
+  draw_commands::Font font;
+  FrameCache cache;
+  std::vector<std::byte> decompressed;
+  std::vector<std::uint32_t> decoded;
+  std::optional<std::uint32_t> last_sequence;
+  std::optional<bool> last_cache_hit;
+  bool in_compressed;
+  bool in_cacheable;
+};
+
+} // namespace lmz
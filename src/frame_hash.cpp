@@ -0,0 +1,119 @@
+#include "frame_hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// BLAKE2b as in RFC 7693, unkeyed.
+namespace {
+
+constexpr std::array<std::uint64_t, 8> iv = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+    0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+};
+
+constexpr std::uint8_t sigma[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+constexpr std::size_t block_size = 128;
+
+// The message words are little endian, like every machine this runs on.
+static_assert(std::endian::native == std::endian::little);
+
+inline void mix(std::uint64_t *v, int a, int b, int c, int d, std::uint64_t x, std::uint64_t y) {
+  v[a] = v[a] + v[b] + x;
+  v[d] = std::rotr(v[d] ^ v[a], 32);
+  v[c] = v[c] + v[d];
+  v[b] = std::rotr(v[b] ^ v[c], 24);
+  v[a] = v[a] + v[b] + y;
+  v[d] = std::rotr(v[d] ^ v[a], 16);
+  v[c] = v[c] + v[d];
+  v[b] = std::rotr(v[b] ^ v[c], 63);
+}
+
+} // namespace
+
+frame_hash::Hasher::Hasher() : state(iv), length(0), buffer(), buffered(0) {
+  // Parameter block: digest length, no key, fanout and depth 1.
+  state[0] ^= 0x01010000 | std::tuple_size_v<FrameHash>;
+}
+
+void frame_hash::Hasher::compress(const std::byte *block, bool last) {
+  std::uint64_t m[16];
+  std::memcpy(m, block, sizeof(m));
+
+  std::uint64_t v[16];
+  std::copy(state.begin(), state.end(), v);
+  std::copy(iv.begin(), iv.end(), v + 8);
+  v[12] ^= length;
+  if (last) {
+    v[14] = ~v[14];
+  }
+
+  for (const auto &s : sigma) {
+    mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+    mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+    mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+    mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+    mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+    mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+    mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+    mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+  }
+
+  for (auto i = 0; i < 8; ++i) {
+    state[i] ^= v[i] ^ v[i + 8];
+  }
+}
+
+void frame_hash::Hasher::update(std::span<const std::byte> data) {
+  // The last block is compressed differently, so a full buffer waits until more data comes.
+  while (!data.empty()) {
+    if (buffered == block_size) {
+      length += block_size;
+      compress(buffer.data(), false);
+      buffered = 0;
+    }
+
+    if (buffered == 0) {
+      while (data.size() > block_size) {
+        length += block_size;
+        compress(data.data(), false);
+        data = data.subspan(block_size);
+      }
+    }
+
+    const auto count = std::min(data.size(), block_size - buffered);
+    std::copy_n(data.begin(), count, buffer.begin() + buffered);
+    buffered += count;
+    data = data.subspan(count);
+  }
+}
+
+frame_hash::FrameHash frame_hash::Hasher::finish() {
+  length += buffered;
+  std::fill(buffer.begin() + buffered, buffer.end(), std::byte{0});
+  compress(buffer.data(), true);
+
+  FrameHash hash;
+  std::memcpy(hash.data(), state.data(), hash.size());
+  return hash;
+}
+
+frame_hash::FrameHash frame_hash::hash(std::span<const std::byte> data) {
+  Hasher hasher;
+  hasher.update(data);
+  return hasher.finish();
+}
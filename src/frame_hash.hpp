@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "frame_messages.hpp"
+
+// Content hashes for the frame cache: BLAKE2b with a 128-bit digest, so two different frames
+// never end up under the same hash in practice, even if someone tries.
+namespace frame_hash {
+
+using lmz::FrameHash;
+
+// Hashes data fed in pieces, e.g. a pixel format and palette before the pixels they describe.
+class Hasher {
+public:
+  Hasher();
+
+  void update(std::span<const std::byte> data);
+
+  // Only call once.
+  FrameHash finish();
+
+private:
+  void compress(const std::byte *block, bool last);
+
+  std::array<std::uint64_t, 8> state;
+  std::uint64_t length;
+  std::array<std::byte, 128> buffer;
+  std::size_t buffered;
+};
+
+FrameHash hash(std::span<const std::byte> data);
+
+} // namespace frame_hash
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace lmz {
+
+// A message on the frame endpoint whose size is exactly width * height * pixel_size is a plain
+// RGBA32 frame. Anything else must start with a FrameHeader saying how to read the rest.
+constexpr std::uint32_t frame_magic = 0x465A4D4C;      // "LMZF", little endian
+constexpr std::uint32_t sync_magic = 0x535A4D4C;       // "LMZS", little endian
+constexpr std::uint32_t cache_miss_magic = 0x4D5A4D4C; // "LMZM", little endian
+
+// Identifies a frame by its content, see frame_hash.hpp.
+using FrameHash = std::array<std::uint8_t, 16>;
+
+enum class FrameType : std::uint8_t {
+  Delta,
+  Pixels,
+  Palette,
+  Compressed,
+  Sequenced,
+  Commands,
+  Atlas,
+  Font,
+  Cached,
+  Cacheable,
+};
+
+enum class PixelFormat : std::uint8_t {
+  Rgba32,
+  Rgb24,
+  Rgb565,
+  Palette8,
+  Gray8,
+};
+
+enum class Compression : std::uint8_t {
+  Lz,
+};
+
+enum class DrawCommandType : std::uint8_t {
+  FillRect,
+  Line,
+  Blit,
+  Text,
+};
+
+namespace {
+
+  constexpr FrameType frame_type_min = FrameType::Delta;
+  constexpr FrameType frame_type_max = FrameType::Cacheable;
+
+#pragma pack(push, 1)
+
+  struct FrameHeader {
+    std::uint32_t magic = frame_magic;
+    FrameType type;
+  };
+
+  // Followed by `rect_count` DeltaRects, each followed by width * height RGBA32 pixels.
+  struct DeltaFrameHeader {
+    FrameHeader header = {.type = FrameType::Delta};
+    std::uint16_t rect_count;
+  };
+
+  struct DeltaRect {
+    std::uint16_t x;
+    std::uint16_t y;
+    std::uint16_t width;
+    std::uint16_t height;
+  };
+
+  // Followed by a full frame of pixels in `format`.
+  struct PixelsFrameHeader {
+    FrameHeader header = {.type = FrameType::Pixels};
+    PixelFormat format;
+  };
+
+  // Followed by `entry_count` RGB24 colors, replacing the start of the Palette8 palette.
+  struct PaletteFrameHeader {
+    FrameHeader header = {.type = FrameType::Palette};
+    std::uint16_t entry_count;
+  };
+
+  // Followed by another frame message, `size` bytes long once decompressed.
+  struct CompressedFrameHeader {
+    FrameHeader header = {.type = FrameType::Compressed};
+    Compression compression;
+    std::uint32_t size;
+  };
+
+  // Followed by another frame message. With a sync endpoint the server draws it but holds it back
+  // until a SyncCommit for `sequence` arrives.
+  struct SequencedFrameHeader {
+    FrameHeader header = {.type = FrameType::Sequenced};
+    std::uint32_t sequence;
+  };
+
+  // Followed by `command_count` draw commands, each one of the command structs below, which the
+  // server draws on top of the previous frame in order.
+  struct CommandsFrameHeader {
+    FrameHeader header = {.type = FrameType::Commands};
+    std::uint16_t command_count;
+  };
+
+  // Colors are RGBA32 like frame pixels, red in the low byte. Anything drawn is clipped to the
+  // frame.
+  struct FillRectCommand {
+    DrawCommandType type = DrawCommandType::FillRect;
+    std::int16_t x;
+    std::int16_t y;
+    std::uint16_t width;
+    std::uint16_t height;
+    std::uint32_t color;
+  };
+
+  struct LineCommand {
+    DrawCommandType type = DrawCommandType::Line;
+    std::int16_t x0;
+    std::int16_t y0;
+    std::int16_t x1;
+    std::int16_t y1;
+    std::uint32_t color;
+  };
+
+  // Copies a rectangle of the uploaded sprite atlas to x, y. Atlas pixels with zero alpha are
+  // left out, so sprites can have transparent parts.
+  struct BlitCommand {
+    DrawCommandType type = DrawCommandType::Blit;
+    std::uint16_t src_x;
+    std::uint16_t src_y;
+    std::uint16_t width;
+    std::uint16_t height;
+    std::int16_t x;
+    std::int16_t y;
+  };
+
+  // Followed by `length` characters, drawn with the uploaded font with the first glyph's top left
+  // at x, y. Characters the font doesn't have are left blank.
+  struct TextCommand {
+    DrawCommandType type = DrawCommandType::Text;
+    std::int16_t x;
+    std::int16_t y;
+    std::uint32_t color;
+    std::uint8_t length;
+  };
+
+  // Followed by width * height RGBA32 pixels, replacing the sprite atlas.
+  struct AtlasFrameHeader {
+    FrameHeader header = {.type = FrameType::Atlas};
+    std::uint16_t width;
+    std::uint16_t height;
+  };
+
+  // Followed by `glyph_count` glyphs for consecutive characters from `first_char`, replacing the
+  // font. Each glyph is `glyph_height` rows of (glyph_width + 7) / 8 bytes, most significant bit
+  // leftmost.
+  struct FontFrameHeader {
+    FrameHeader header = {.type = FrameType::Font};
+    std::uint8_t glyph_width;
+    std::uint8_t glyph_height;
+    std::uint8_t first_char;
+    std::uint8_t glyph_count;
+  };
+
+  // Shows the frame the server cached under `hash`. In req-rep mode the server replies with a
+  // CacheMissReply if it doesn't have it, and the producer should send the frame again in full.
+  struct CachedFrameHeader {
+    FrameHeader header = {.type = FrameType::Cached};
+    FrameHash hash;
+  };
+
+  // Followed by another frame message. The server shows it as usual and caches the resulting
+  // frame under `hash`, the frame_hash of its RGBA32 pixels. A frame whose hash doesn't match
+  // is shown but not cached.
+  struct CacheableFrameHeader {
+    FrameHeader header = {.type = FrameType::Cacheable};
+    FrameHash hash;
+  };
+
+  // The reply to a CachedFrameHeader the server has no frame for. Any other reply is empty.
+  struct CacheMissReply {
+    std::uint32_t magic = cache_miss_magic;
+    FrameHash hash;
+  };
+
+  // Published on the sync endpoint once every server has frame `sequence`, telling them all to
+  // present it.
+  struct SyncCommit {
+    std::uint32_t magic = sync_magic;
+    std::uint32_t sequence;
+  };
+
+#pragma pack(pop)
+
+} // namespace
+
+inline FrameType get_frame_type_from_data(const std::span<const std::byte> &data) {
+  using UnderlyingType = std::underlying_type_t<FrameType>;
+
+  if (data.size() < sizeof(FrameHeader)) {
+    throw std::runtime_error("Received frame message without a header");
+  }
+
+  FrameHeader header;
+  std::copy_n(data.begin(), sizeof(header), reinterpret_cast<std::byte *>(&header));
+  if (header.magic != frame_magic) {
+    throw std::runtime_error("Received frame message with invalid magic");
+  }
+
+  const auto type_underlying = static_cast<UnderlyingType>(header.type);
+  if (type_underlying < static_cast<UnderlyingType>(frame_type_min) ||
+      type_underlying > static_cast<UnderlyingType>(frame_type_max)) {
+    throw std::runtime_error("Received frame message with invalid type");
+  }
+
+  return header.type;
+}
+
+// Reads a fixed-size struct from the front of `data` and advances it past it.
+template <typename T> T read_frame_struct(std::span<const std::byte> &data) {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  if (data.size() < sizeof(T)) {
+    throw std::runtime_error("Received truncated frame message");
+  }
+
+  T value;
+  std::copy_n(data.begin(), sizeof(T), reinterpret_cast<std::byte *>(&value));
+  data = data.subspan(sizeof(T));
+  return value;
+}
+
+// The hash a Cached frame message refers to, or nothing for any other message.
+inline std::optional<FrameHash> get_cached_frame_hash(std::span<const std::byte> data) {
+  CachedFrameHeader header;
+  if (data.size() != sizeof(header)) {
+    return std::nullopt;
+  }
+
+  std::copy_n(data.begin(), sizeof(header), reinterpret_cast<std::byte *>(&header));
+  if (header.header.magic != frame_magic || header.header.type != FrameType::Cached) {
+    return std::nullopt;
+  }
+
+  return header.hash;
+}
+
+// Whether frame sequence number `a` comes after `b`, allowing for wraparound.
+inline bool sequence_after(std::uint32_t a, std::uint32_t b) {
+  return static_cast<std::int32_t>(a - b) > 0;
+}
+
+} // namespace lmz
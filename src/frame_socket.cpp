@@ -0,0 +1,190 @@
+#include "frame_socket.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+frame_socket::Mode mode_from_string(const std::string &value) {
+  if (value == "req-rep") {
+    return frame_socket::Mode::ReqRep;
+  } else if (value == "push-pull") {
+    return frame_socket::Mode::PushPull;
+  } else if (value == "pub-sub") {
+    return frame_socket::Mode::PubSub;
+  }
+
+  throw std::runtime_error("Invalid frame socket type: " + value);
+}
+
+frame_socket::DropPolicy drop_policy_from_string(const std::string &value) {
+  if (value == "block") {
+    return frame_socket::DropPolicy::Block;
+  } else if (value == "drop-newest") {
+    return frame_socket::DropPolicy::DropNewest;
+  } else if (value == "drop-oldest") {
+    return frame_socket::DropPolicy::DropOldest;
+  }
+
+  throw std::runtime_error("Invalid frame drop policy: " + value);
+}
+
+void apply_options(zmq::socket_t &sock, const frame_socket::Options &options) {
+  if (options.mode == frame_socket::Mode::ReqRep) {
+    return;
+  }
+
+  sock.set(zmq::sockopt::sndhwm, options.hwm);
+  sock.set(zmq::sockopt::rcvhwm, options.hwm);
+
+  if (options.drop_policy == frame_socket::DropPolicy::DropOldest) {
+    sock.set(zmq::sockopt::conflate, true);
+  }
+}
+
+} // namespace
+
+void frame_socket::add_arguments(argparse::ArgumentParser &parser, const std::string &prefix) {
+  parser.add_argument("--" + prefix + "-socket-type")
+      .help("Frame transport: req-rep, push-pull or pub-sub")
+      .default_value(std::string("req-rep"));
+  parser.add_argument("--" + prefix + "-hwm")
+      .help("High water mark for pipelined frame sockets")
+      .default_value(1000)
+      .scan<'i', int>();
+  parser.add_argument("--" + prefix + "-drop-policy")
+      .help("Pipelined overflow policy: block, drop-newest or drop-oldest")
+      .default_value(std::string("block"));
+}
+
+frame_socket::Options frame_socket::options_from_args(const argparse::ArgumentParser &parser,
+                                                      const std::string &prefix) {
+  const auto options = Options{
+      .mode = mode_from_string(parser.get<std::string>("--" + prefix + "-socket-type")),
+      .drop_policy =
+          drop_policy_from_string(parser.get<std::string>("--" + prefix + "-drop-policy")),
+      .hwm = parser.get<int>("--" + prefix + "-hwm"),
+  };
+
+  if (options.mode == Mode::ReqRep && options.drop_policy != DropPolicy::Block) {
+    throw std::runtime_error("Drop policies only apply to push-pull and pub-sub frame sockets");
+  }
+
+  return options;
+}
+
+const char *frame_socket::name(Mode mode) {
+  switch (mode) {
+  case Mode::ReqRep:
+    return "req-rep";
+  case Mode::PushPull:
+    return "push-pull";
+  case Mode::PubSub:
+    return "pub-sub";
+  }
+
+  return "unknown";
+}
+
+zmq::socket_t frame_socket::make_receiver(zmq::context_t &ctx, const Options &options) {
+  zmq::socket_t sock;
+
+  switch (options.mode) {
+  case Mode::ReqRep:
+    sock = zmq::socket_t(ctx, zmq::socket_type::rep);
+    break;
+  case Mode::PushPull:
+    sock = zmq::socket_t(ctx, zmq::socket_type::pull);
+    break;
+  case Mode::PubSub:
+    sock = zmq::socket_t(ctx, zmq::socket_type::sub);
+    sock.set(zmq::sockopt::subscribe, "");
+    break;
+  }
+
+  apply_options(sock, options);
+  return sock;
+}
+
+zmq::socket_t frame_socket::make_sender(zmq::context_t &ctx, const Options &options) {
+  zmq::socket_t sock;
+
+  switch (options.mode) {
+  case Mode::ReqRep:
+    sock = zmq::socket_t(ctx, zmq::socket_type::req);
+    break;
+  case Mode::PushPull:
+    sock = zmq::socket_t(ctx, zmq::socket_type::push);
+    break;
+  case Mode::PubSub:
+    sock = zmq::socket_t(ctx, zmq::socket_type::pub);
+    break;
+  }
+
+  apply_options(sock, options);
+  return sock;
+}
+
+bool frame_socket::send_frame(zmq::socket_t &sock, const Options &options,
+                              zmq::const_buffer frame) {
+  const auto flags = options.drop_policy == DropPolicy::DropNewest ? zmq::send_flags::dontwait
+                                                                   : zmq::send_flags::none;
+  if (!sock.send(frame, flags)) {
+    return false;
+  }
+
+  if (options.mode == Mode::ReqRep) {
+    zmq::message_t rep;
+    return sock.recv(rep).has_value();
+  }
+
+  return true;
+}
+
+void frame_socket::acknowledge_frame(zmq::socket_t &sock, const Options &options) {
+  if (options.mode == Mode::ReqRep) {
+    sock.send(zmq::const_buffer(), zmq::send_flags::none);
+  }
+}
+
+std::optional<bool> frame_socket::send_cached_frame(zmq::socket_t &sock, const Options &options,
+                                                    const lmz::FrameHash &hash) {
+  const lmz::CachedFrameHeader header = {.hash = hash};
+  const auto flags = options.drop_policy == DropPolicy::DropNewest ? zmq::send_flags::dontwait
+                                                                   : zmq::send_flags::none;
+  if (!sock.send(zmq::const_buffer(&header, sizeof(header)), flags)) {
+    return std::nullopt;
+  }
+
+  if (options.mode != Mode::ReqRep) {
+    return true;
+  }
+
+  zmq::message_t rep;
+  if (!sock.recv(rep)) {
+    return std::nullopt;
+  }
+
+  lmz::CacheMissReply miss;
+  if (rep.size() != sizeof(miss)) {
+    return true;
+  }
+
+  std::memcpy(&miss, rep.data(), sizeof(miss));
+  return miss.magic != lmz::cache_miss_magic || miss.hash != hash;
+}
+
+void frame_socket::acknowledge_cached_frame(zmq::socket_t &sock, const Options &options,
+                                            const lmz::FrameHash &hash, bool hit) {
+  if (options.mode != Mode::ReqRep) {
+    return;
+  }
+
+  if (hit) {
+    sock.send(zmq::const_buffer(), zmq::send_flags::none);
+  } else {
+    const lmz::CacheMissReply miss = {.hash = hash};
+    sock.send(zmq::const_buffer(&miss, sizeof(miss)), zmq::send_flags::none);
+  }
+}
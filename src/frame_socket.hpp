@@ -0,0 +1,61 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include <argparse/argparse.hpp>
+#include <zmq.hpp>
+
+#include "frame_messages.hpp"
+
+namespace frame_socket {
+
+// How frames travel between a producer and the server. Each side opens its own half of the
+// pattern, e.g. the server binds REP/PULL/SUB and the producer connects REQ/PUSH/PUB.
+enum class Mode {
+  ReqRep,
+  PushPull,
+  PubSub,
+};
+
+// What happens once a pipelined socket reaches its high water mark.
+enum class DropPolicy {
+  Block,      // Wait for room (PUSH), or let ZMQ drop (PUB).
+  DropNewest, // Drop the frame being sent.
+  DropOldest, // Keep only the latest queued frame (ZMQ_CONFLATE).
+};
+
+struct Options {
+  Mode mode;
+  DropPolicy drop_policy;
+  int hwm;
+};
+
+// Adds --<prefix>-socket-type, --<prefix>-hwm and --<prefix>-drop-policy.
+void add_arguments(argparse::ArgumentParser &parser, const std::string &prefix = "frame");
+Options options_from_args(const argparse::ArgumentParser &parser,
+                          const std::string &prefix = "frame");
+
+const char *name(Mode mode);
+
+zmq::socket_t make_receiver(zmq::context_t &ctx, const Options &options);
+zmq::socket_t make_sender(zmq::context_t &ctx, const Options &options);
+
+// Sends a frame and, in REQ/REP mode, waits for the reply. Returns false if the frame was
+// dropped because of the drop policy, or no reply came within the socket's receive timeout.
+bool send_frame(zmq::socket_t &sock, const Options &options, zmq::const_buffer frame);
+
+// Sends a Cached frame message for `hash`. Returns false if the server replied that it doesn't
+// have the frame, which only happens in REQ/REP mode, or nothing if it was dropped as above.
+std::optional<bool> send_cached_frame(zmq::socket_t &sock, const Options &options,
+                                      const lmz::FrameHash &hash);
+
+// Acknowledges a received frame, which is only needed in REQ/REP mode.
+void acknowledge_frame(zmq::socket_t &sock, const Options &options);
+
+// Acknowledges a Cached frame message, which is held back until the cache was looked up so a
+// miss can be reported.
+void acknowledge_cached_frame(zmq::socket_t &sock, const Options &options,
+                              const lmz::FrameHash &hash, bool hit);
+
+} // namespace frame_socket
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Init.h>
+#include <plog/Log.h>
+#include <zmq.hpp>
+
+#include "consts.hpp"
+#include "frame_socket.hpp"
+#include "messages.hpp"
+#include "test_pattern.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// What one connection did over the run.
+struct ConnectionResult {
+  std::uint64_t sent;
+  std::uint64_t dropped;
+  std::uint64_t late;
+  std::vector<std::chrono::nanoseconds> round_trips;
+};
+
+struct LoadOptions {
+  std::string frame_endpoint;
+  frame_socket::Options frame_socket_options;
+  int width;
+  int height;
+  double fps;
+  std::chrono::nanoseconds duration;
+};
+
+static lmz::StatsArgs get_stats(zmq::socket_t &sock, bool reset) {
+  const auto req_msg = lmz::GetStatsRequest{.args = {.reset = reset}};
+  sock.send(zmq::const_buffer(&req_msg, sizeof(req_msg)), zmq::send_flags::none);
+
+  zmq::message_t reply;
+  static_cast<void>(sock.recv(reply, zmq::recv_flags::none));
+  const auto data = std::span<const std::byte>(reply.data<const std::byte>(), reply.size());
+  return lmz::get_message_from_data<lmz::GetStatsReply>(data).args;
+}
+
+// Sends frames over one connection until the run is over, at `fps` or as fast as the socket
+// takes them if that is 0. A frame more than one interval behind schedule is counted as late and
+// the schedule restarts from now rather than bursting to catch up.
+static void run_connection(zmq::context_t &ctx, const LoadOptions &options, double fps,
+                           ConnectionResult &result) {
+  auto sock = frame_socket::make_sender(ctx, options.frame_socket_options);
+  sock.connect(options.frame_endpoint);
+
+  std::vector<std::uint32_t> frame(options.width * options.height);
+  test_pattern::render(frame, options.width, options.height);
+  const auto req = zmq::const_buffer(frame.data(), frame.size() * sizeof(std::uint32_t));
+
+  const auto interval =
+      fps > 0 ? std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::duration<double>(1.0 / fps))
+              : std::chrono::nanoseconds(0);
+  const auto start = Clock::now();
+  auto next = start;
+
+  for (std::uint64_t i = 0; Clock::now() - start < options.duration; ++i) {
+    if (interval.count() > 0) {
+      std::this_thread::sleep_until(next);
+      const auto now = Clock::now();
+      next += interval;
+      if (now > next) {
+        result.late++;
+        next = now + interval;
+      }
+    }
+
+    // A moving line, so every frame differs from the one before it.
+    const auto x = i % options.width;
+    const auto saved = frame[x];
+    frame[x] = 0xFFFFFFFF;
+
+    const auto sent = Clock::now();
+    if (frame_socket::send_frame(sock, options.frame_socket_options, req)) {
+      result.sent++;
+      result.round_trips.push_back(Clock::now() - sent);
+    } else {
+      result.dropped++;
+    }
+
+    frame[x] = saved;
+  }
+}
+
+static std::int64_t percentile_us(const std::vector<std::chrono::nanoseconds> &sorted,
+                                  double quantile) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  const auto index = static_cast<std::size_t>(quantile * (sorted.size() - 1));
+  return std::chrono::duration_cast<std::chrono::microseconds>(sorted[index]).count();
+}
+
+int main(int argc, char *argv[]) {
+  static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+  plog::init(plog::info, &consoleAppender);
+
+  argparse::ArgumentParser program("led-matrix-zmq-load");
+  program.add_description("Sends synthetic frames to led-matrix-zmq-server and measures how fast "
+                          "they get through");
+
+  program.add_argument("-w", "--width").default_value(32).scan<'i', int>();
+  program.add_argument("-h", "--height").default_value(32).scan<'i', int>();
+  program.add_argument("-f", "--frame-endpoint").default_value(consts::default_frame_endpoint);
+  program.add_argument("-c", "--control-endpoint")
+      .help("Also fetch the server's stats for the run from here");
+  frame_socket::add_arguments(program);
+  program.add_argument("--fps")
+      .help("Total frame rate to aim for across all connections, 0 for as fast as possible")
+      .default_value(0.0)
+      .scan<'g', double>();
+  program.add_argument("-n", "--connections")
+      .help("Number of concurrent connections to spread the load over")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("-d", "--duration")
+      .help("How long to run for, in seconds")
+      .default_value(10.0)
+      .scan<'g', double>();
+
+  LoadOptions options;
+  int connections;
+  try {
+    program.parse_args(argc, argv);
+
+    options = {
+        .frame_endpoint = program.get<std::string>("--frame-endpoint"),
+        .frame_socket_options = frame_socket::options_from_args(program),
+        .width = program.get<int>("--width"),
+        .height = program.get<int>("--height"),
+        .fps = program.get<double>("--fps"),
+        .duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(program.get<double>("--duration"))),
+    };
+    connections = program.get<int>("--connections");
+
+    if (connections < 1 || options.fps < 0 || options.duration.count() <= 0) {
+      throw std::runtime_error("--connections, --fps and --duration must be positive");
+    }
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  zmq::context_t ctx;
+
+  std::optional<zmq::socket_t> control_sock;
+  if (const auto control_endpoint = program.present("--control-endpoint")) {
+    control_sock.emplace(ctx, zmq::socket_type::req);
+    control_sock->connect(*control_endpoint);
+    static_cast<void>(get_stats(*control_sock, true));
+  }
+
+  PLOG_INFO << "Sending " << options.width << "x" << options.height << " frames to "
+            << options.frame_endpoint << " ("
+            << frame_socket::name(options.frame_socket_options.mode) << ") over " << connections
+            << " connection(s) for "
+            << std::chrono::duration<double>(options.duration).count() << "s";
+
+  std::vector<ConnectionResult> results(connections);
+  std::vector<std::thread> threads;
+  const auto start = Clock::now();
+  for (auto &result : results) {
+    threads.emplace_back(run_connection, std::ref(ctx), std::cref(options),
+                         options.fps / connections, std::ref(result));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  ConnectionResult total = {};
+  for (const auto &result : results) {
+    total.sent += result.sent;
+    total.dropped += result.dropped;
+    total.late += result.late;
+    total.round_trips.insert(total.round_trips.end(), result.round_trips.begin(),
+                             result.round_trips.end());
+  }
+  std::sort(total.round_trips.begin(), total.round_trips.end());
+
+  std::cout << std::fixed << std::setprecision(1);
+  const auto frame_size = options.width * options.height * consts::pixel_size;
+  std::cout << "sent " << total.sent << " frames in " << elapsed << "s: " << total.sent / elapsed
+            << " fps (" << total.sent * frame_size / elapsed / 1e6 << " MB/s), " << total.dropped
+            << " dropped, " << total.late << " late" << std::endl;
+
+  for (std::size_t i = 0; connections > 1 && i < results.size(); ++i) {
+    std::cout << "connection " << i << ": " << results[i].sent / elapsed << " fps" << std::endl;
+  }
+
+  // Only REQ/REP waits for the server, pipelined sends just time handing the frame to ZMQ.
+  const auto *latency_name =
+      options.frame_socket_options.mode == frame_socket::Mode::ReqRep ? "rtt" : "send";
+  std::cout << latency_name << " p50=" << percentile_us(total.round_trips, 0.5)
+            << "us p99=" << percentile_us(total.round_trips, 0.99)
+            << "us p999=" << percentile_us(total.round_trips, 0.999)
+            << "us max=" << percentile_us(total.round_trips, 1.0) << "us" << std::endl;
+
+  if (control_sock) {
+    const auto args = get_stats(*control_sock, false);
+    std::cout << "server: " << args.frames_received << " received, " << args.frames_rendered
+              << " rendered, " << args.frames_dropped << " superseded, " << args.frames_skipped
+              << " unchanged, " << args.frames_rejected << " rejected" << std::endl;
+  }
+
+  return 0;
+}
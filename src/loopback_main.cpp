@@ -0,0 +1,208 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Init.h>
+#include <plog/Log.h>
+#include <unistd.h>
+#include <zmq.hpp>
+
+#include "color_temp.hpp"
+#include "consts.hpp"
+#include "frame_socket.hpp"
+#include "memory_canvas.hpp"
+#include "messages.hpp"
+#include "pixel_kernel.hpp"
+#include "server.hpp"
+#include "stats.hpp"
+#include "test_pattern.hpp"
+
+// What the canvas should show for `frame` at full brightness and the default temperature.
+static std::vector<std::uint32_t> expected_canvas(const std::vector<std::uint32_t> &frame) {
+  const auto scale = pixel_kernel::make_scale(255, color_temp::get(color_temp::max));
+  std::vector<std::uint32_t> out(frame.size());
+  pixel_kernel::get(pixel_kernel::Path::Scalar)(frame.data(), out.data(), frame.size(), scale);
+  return out;
+}
+
+// The first frames size the server's buffers, so allocations are only counted after these.
+static constexpr auto warmup_frames = 16;
+
+static lmz::StatsArgs get_stats(zmq::socket_t &sock, bool reset = false) {
+  const auto req_msg = lmz::GetStatsRequest{.args = {.reset = reset}};
+  sock.send(zmq::const_buffer(&req_msg, sizeof(req_msg)), zmq::send_flags::none);
+
+  zmq::message_t reply;
+  static_cast<void>(sock.recv(reply, zmq::recv_flags::none));
+  const auto data = std::span<const std::byte>(reply.data<const std::byte>(), reply.size());
+  return lmz::get_message_from_data<lmz::GetStatsReply>(data).args;
+}
+
+static void print_histogram(const std::string &name,
+                            std::span<const uint64_t, stats::histogram_buckets> buckets) {
+  std::cout << name << " p50<=" << stats::percentile_us(buckets, 0.5)
+            << "us p99<=" << stats::percentile_us(buckets, 0.99)
+            << "us max<=" << stats::percentile_us(buckets, 1.0) << "us" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+  plog::init(plog::warning, &consoleAppender);
+
+  argparse::ArgumentParser program("led-matrix-zmq-loopback");
+  program.add_description(
+      "Runs the server on an in-memory canvas and drives it end-to-end over ipc://, checking "
+      "what it draws and reporting how fast it goes");
+
+  program.add_argument("-w", "--width").default_value(128).scan<'i', int>();
+  program.add_argument("-h", "--height").default_value(128).scan<'i', int>();
+  program.add_argument("-n", "--frames").default_value(1000).scan<'i', int>();
+  program.add_argument("--timeout-ms")
+      .help("How long to wait for the last frame to be drawn")
+      .default_value(5000)
+      .scan<'i', int>();
+  frame_socket::add_arguments(program);
+  program.add_argument("--serve")
+      .help("Just serve on --frame-endpoint and --control-endpoint until killed, as a stand-in "
+            "for a real server")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--frame-endpoint").default_value(consts::default_frame_endpoint);
+  program.add_argument("--control-endpoint").default_value(consts::default_control_endpoint);
+  program.add_argument("--sync-endpoint").help("With --serve, present on commits from here");
+
+  lmz::ServerOptions server_options;
+  try {
+    program.parse_args(argc, argv);
+    server_options.frame_socket_options = frame_socket::options_from_args(program);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  const auto width = program.get<int>("--width");
+  const auto height = program.get<int>("--height");
+  const auto frame_count = program.get<int>("--frames");
+  const auto timeout = std::chrono::milliseconds(program.get<int>("--timeout-ms"));
+
+  if (program.get<bool>("--serve")) {
+    plog::get()->setMaxSeverity(plog::info);
+    server_options.frame_endpoint = program.get<std::string>("--frame-endpoint");
+    server_options.control_endpoint = program.get<std::string>("--control-endpoint");
+    server_options.sync_endpoint = program.present("--sync-endpoint").value_or("");
+
+    lmz::MemoryCanvas canvas(width, height);
+    lmz::Server server(canvas, server_options);
+    server.start();
+    server.wait();
+    return 0;
+  }
+
+  const auto endpoint_prefix = "ipc:///tmp/lmz-loopback-" + std::to_string(getpid());
+  server_options.frame_endpoint = endpoint_prefix + "-frame.sock";
+  server_options.control_endpoint = endpoint_prefix + "-control.sock";
+  server_options.test_pattern = false;
+
+  lmz::MemoryCanvas canvas(width, height);
+  lmz::Server server(canvas, server_options);
+  server.start();
+
+  const auto &socket_options = server_options.frame_socket_options;
+  zmq::context_t ctx;
+  auto frame_sock = frame_socket::make_sender(ctx, socket_options);
+  frame_sock.connect(server_options.frame_endpoint);
+  zmq::socket_t control_sock(ctx, zmq::socket_type::req);
+  control_sock.connect(server_options.control_endpoint);
+
+  // Once the control socket answers, the frame socket is bound too, so no early frames are lost.
+  static_cast<void>(get_stats(control_sock));
+
+  std::vector<std::uint32_t> frame(width * height);
+  test_pattern::render(frame, width, height);
+
+  // Sends frames numbered [first, first + count) and returns how many were delivered.
+  const auto send_frames = [&](int first, int count) {
+    auto sent = 0;
+    for (auto i = first; i < first + count; ++i) {
+      // Make every frame differ from the last, in a different row each time.
+      frame[(i % height) * width] = i;
+      const auto req = zmq::const_buffer(frame.data(), frame.size() * sizeof(std::uint32_t));
+      auto delivered = frame_socket::send_frame(frame_sock, socket_options, req);
+
+      // The last frame is checked against the canvas, so it must not be dropped.
+      while (!delivered && i == first + count - 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        delivered = frame_socket::send_frame(frame_sock, socket_options, req);
+      }
+      sent += delivered;
+    }
+    return sent;
+  };
+
+  // Whether the canvas shows the last frame sent by `deadline`.
+  const auto wait_until_drawn = [&](std::chrono::steady_clock::time_point deadline) {
+    const auto expected = expected_canvas(frame);
+    auto matches = false;
+    while (!(matches = canvas.front() == expected) && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return matches;
+  };
+
+  send_frames(0, warmup_frames);
+  if (!wait_until_drawn(std::chrono::steady_clock::now() + timeout)) {
+    std::cerr << "Canvas does not show the last warm-up frame" << std::endl;
+    return 1;
+  }
+  static_cast<void>(get_stats(control_sock, true));
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto sent = send_frames(warmup_frames, frame_count);
+  const auto send_elapsed = std::chrono::steady_clock::now() - start;
+  const auto matches = wait_until_drawn(start + send_elapsed + timeout);
+  const auto drawn_elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto args = get_stats(control_sock);
+
+  frame_sock.close();
+  control_sock.close();
+  server.stop();
+
+  using ms = std::chrono::duration<double, std::milli>;
+  std::cout << "mode " << frame_socket::name(socket_options.mode) << ", " << width << "x"
+            << height << ", " << sent << "/" << frame_count << " frames sent" << std::endl;
+  std::cout << "sent in " << ms(send_elapsed).count() << "ms ("
+            << sent / std::chrono::duration<double>(send_elapsed).count() << " fps), drawn in "
+            << ms(drawn_elapsed).count() << "ms" << std::endl;
+  std::cout << "frames_received " << args.frames_received << " frames_rendered "
+            << args.frames_rendered << " frames_dropped " << args.frames_dropped
+            << " frames_skipped " << args.frames_skipped << " frames_rejected "
+            << args.frames_rejected << std::endl;
+  std::cout << "frame_path_allocations " << args.frame_path_allocations << std::endl;
+  print_histogram("display_latency", stats::copy_from_message(args.display_latency_us));
+  print_histogram("render_time", stats::copy_from_message(args.render_time_us));
+
+  if (!matches) {
+    std::cerr << "Canvas does not show the last frame sent" << std::endl;
+    return 1;
+  }
+
+  if (!args.allocations_counted) {
+    std::cerr << "Server did not count frame path allocations" << std::endl;
+    return 1;
+  }
+  if (args.frame_path_allocations != 0) {
+    std::cerr << "Frame and render threads allocated " << args.frame_path_allocations
+              << " times after warm-up" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
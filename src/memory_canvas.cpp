@@ -0,0 +1,38 @@
+#include "memory_canvas.hpp"
+
+#include <algorithm>
+
+lmz::MemoryCanvas::MemoryCanvas(int width, int height)
+    : canvas_width(width), canvas_height(height),
+      buffers{std::vector<std::uint32_t>(width * height),
+              std::vector<std::uint32_t>(width * height)},
+      back_index(0), presented_count(0) {}
+
+int lmz::MemoryCanvas::width() const { return canvas_width; }
+int lmz::MemoryCanvas::height() const { return canvas_height; }
+
+int lmz::MemoryCanvas::buffer_count() const { return 2; }
+int lmz::MemoryCanvas::back_buffer() const { return back_index; }
+
+void lmz::MemoryCanvas::set_row(int y, std::span<const std::uint32_t> pixels) {
+  std::transform(pixels.begin(), pixels.end(), buffers[back_index].begin() + y * canvas_width,
+                 [](auto pixel) { return pixel & 0x00FFFFFF; });
+}
+
+void lmz::MemoryCanvas::present() {
+  {
+    const std::lock_guard<std::mutex> guard(front_mutex);
+    back_index ^= 1;
+  }
+
+  presented_count.fetch_add(1, std::memory_order_release);
+}
+
+std::uint64_t lmz::MemoryCanvas::presented() const {
+  return presented_count.load(std::memory_order_acquire);
+}
+
+std::vector<std::uint32_t> lmz::MemoryCanvas::front() const {
+  const std::lock_guard<std::mutex> guard(front_mutex);
+  return buffers[back_index ^ 1];
+}
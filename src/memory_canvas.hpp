@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "canvas.hpp"
+
+namespace lmz {
+
+// A hardware-free canvas keeping its buffers in memory, so the server can run, be tested and be
+// profiled anywhere.
+class MemoryCanvas : public Canvas {
+public:
+  MemoryCanvas(int width, int height);
+
+  int width() const override;
+  int height() const override;
+
+  int buffer_count() const override;
+  int back_buffer() const override;
+
+  void set_row(int y, std::span<const std::uint32_t> pixels) override;
+  void present() override;
+
+  // Number of frames presented so far.
+  std::uint64_t presented() const;
+
+  // A copy of the buffer currently being shown.
+  std::vector<std::uint32_t> front() const;
+
+private:
+  int canvas_width;
+  int canvas_height;
+
+  std::vector<std::uint32_t> buffers[2];
+  int back_index;
+
+  mutable std::mutex front_mutex;
+  std::atomic<std::uint64_t> presented_count;
+};
+
+} // namespace lmz
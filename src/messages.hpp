@@ -21,12 +21,62 @@ enum class MessageId : std::uint8_t {
 
   GetConfigurationRequest,
   GetConfigurationReply,
+
+  GetStatsRequest,
+  GetStatsReply,
+
+  LoadClipRequest,
+  ClipControlRequest,
+  GetClipStatusRequest,
+  ClipStatusReply,
+
+  FadeBrightnessRequest,
+  FadeTemperatureRequest,
+
+  LoadCalibrationRequest,
+  SetTileCalibrationRequest,
+  GetCalibrationRequest,
+  CalibrationReply,
+};
+
+enum class ClipState : std::uint8_t {
+  Stopped,
+  Playing,
+  Paused,
+};
+
+enum class ClipAction : std::uint8_t {
+  Play,
+  Pause,
+  Stop,
+  Seek,    // value is the frame to show
+  SetRate, // value is the playback rate in percent of the clip's own frame rate
+  SetLoop, // value is 0 or 1
 };
 
+constexpr std::size_t clip_path_max = 256;
+
+constexpr std::size_t calibration_path_max = 256;
+
+// Tile calibration gains and gammas travel as thousandths, so 1000 is 1.0.
+constexpr std::uint16_t calibration_unit = 1000;
+
+enum class Easing : std::uint8_t {
+  Linear,
+  EaseIn,
+  EaseOut,
+  EaseInOut,
+};
+
+// Stats histograms use power-of-two microsecond buckets: bucket i counts durations in
+// [2^i, 2^(i+1)) us, with bucket 0 also counting anything under 1us and the last bucket
+// anything longer.
+constexpr std::size_t stats_histogram_buckets = 24;
+
 namespace {
 
   constexpr MessageId message_id_min = MessageId::NullReply;
-  constexpr MessageId message_id_max = MessageId::GetConfigurationReply;
+  constexpr MessageId message_id_max = MessageId::CalibrationReply;
 
 #pragma pack(push, 1)
 
@@ -45,6 +95,84 @@ namespace {
     uint16_t temperature;
   };
 
+  struct StatsRequestArgs {
+    uint8_t reset;
+  };
+
+  struct StatsArgs {
+    uint64_t frames_received;
+    uint64_t frames_rendered;
+    uint64_t frames_rejected;
+    uint64_t frames_dropped;
+    uint64_t frames_skipped; // Identical to the frame before, so never copied or rendered
+    uint64_t bytes_in;
+    uint64_t control_requests;
+    uint64_t redraws_coalesced;
+    uint64_t frames_synced; // Presented on their sync commit
+    uint64_t sync_missed;   // Commits whose frame didn't arrive in time, or was already replaced
+    uint64_t sync_timeouts; // Sequenced frames presented late because no commit came
+    uint64_t cache_hits;    // Cached frame messages the frame cache had the frame for
+    uint64_t cache_misses;  // Cached frame messages the producer had to send in full
+
+    // C++ operator new calls on the frame and render threads while taking in and drawing frames.
+    // Allocations inside libzmq aren't seen. Only counted if allocations_counted is set, which
+    // it isn't for the server itself, see alloc_counter.hpp.
+    uint64_t frame_path_allocations;
+    uint8_t allocations_counted;
+
+    uint64_t display_latency_us[stats_histogram_buckets];
+    uint64_t render_time_us[stats_histogram_buckets];
+    uint64_t sync_skew_us[stats_histogram_buckets]; // From a commit arriving to its present
+  };
+
+  struct LoadClipArgs {
+    char path[clip_path_max]; // Null-terminated, on the server's filesystem
+    uint8_t loop;
+  };
+
+  struct ClipControlArgs {
+    ClipAction action;
+    uint32_t value;
+  };
+
+  struct FadeBrightnessArgs {
+    uint8_t brightness;
+    uint32_t duration_ms;
+    Easing easing;
+  };
+
+  struct FadeTemperatureArgs {
+    uint16_t temperature;
+    uint32_t duration_ms;
+    Easing easing;
+  };
+
+  struct ClipStatusArgs {
+    ClipState state;
+    uint32_t frame;
+    uint32_t frame_count;
+    uint32_t frame_interval_us;
+    uint16_t rate_percent;
+    uint8_t loop;
+  };
+
+  struct LoadCalibrationArgs {
+    char path[calibration_path_max]; // Null-terminated, on the server's filesystem. Empty clears.
+  };
+
+  struct TileCalibrationArgs {
+    uint16_t x; // Tile column and row
+    uint16_t y;
+    uint16_t gain[3]; // r, g, b in calibration_unit
+    uint16_t gamma[3];
+  };
+
+  struct CalibrationArgs {
+    uint16_t tile_width;
+    uint16_t tile_height;
+    uint16_t tile_count; // Tiles with a correction, 0 when uncalibrated
+  };
+
   template <MessageId Id, typename ArgsT = NullArgs> struct Message {
     const MessageId id = Id;
     ArgsT args;
@@ -76,6 +204,23 @@ using SetTemperatureRequest = Message<MessageId::SetTemperatureRequest, Temperat
 using GetConfigurationRequest = Message<MessageId::GetConfigurationRequest>;
 using GetConfigurationReply = Message<MessageId::GetConfigurationReply, ConfigurationArgs>;
 
+using GetStatsRequest = Message<MessageId::GetStatsRequest, StatsRequestArgs>;
+using GetStatsReply = Message<MessageId::GetStatsReply, StatsArgs>;
+
+using LoadClipRequest = Message<MessageId::LoadClipRequest, LoadClipArgs>;
+using ClipControlRequest = Message<MessageId::ClipControlRequest, ClipControlArgs>;
+using GetClipStatusRequest = Message<MessageId::GetClipStatusRequest>;
+using ClipStatusReply = Message<MessageId::ClipStatusReply, ClipStatusArgs>;
+
+using FadeBrightnessRequest = Message<MessageId::FadeBrightnessRequest, FadeBrightnessArgs>;
+using FadeTemperatureRequest = Message<MessageId::FadeTemperatureRequest, FadeTemperatureArgs>;
+
+using LoadCalibrationRequest = Message<MessageId::LoadCalibrationRequest, LoadCalibrationArgs>;
+using SetTileCalibrationRequest =
+    Message<MessageId::SetTileCalibrationRequest, TileCalibrationArgs>;
+using GetCalibrationRequest = Message<MessageId::GetCalibrationRequest>;
+using CalibrationReply = Message<MessageId::CalibrationReply, CalibrationArgs>;
+
 namespace {
   template <IsMessage MessageT> struct MessageRequestReply {
     static_assert(false, "No reply type defined for this message");
@@ -100,6 +245,42 @@ namespace {
   template <> struct MessageRequestReply<GetConfigurationRequest> {
     using ReplyType = GetConfigurationReply;
   };
+
+  template <> struct MessageRequestReply<GetStatsRequest> {
+    using ReplyType = GetStatsReply;
+  };
+
+  template <> struct MessageRequestReply<LoadClipRequest> {
+    using ReplyType = ClipStatusReply;
+  };
+
+  template <> struct MessageRequestReply<ClipControlRequest> {
+    using ReplyType = ClipStatusReply;
+  };
+
+  template <> struct MessageRequestReply<GetClipStatusRequest> {
+    using ReplyType = ClipStatusReply;
+  };
+
+  template <> struct MessageRequestReply<FadeBrightnessRequest> {
+    using ReplyType = NullReply;
+  };
+
+  template <> struct MessageRequestReply<FadeTemperatureRequest> {
+    using ReplyType = NullReply;
+  };
+
+  template <> struct MessageRequestReply<LoadCalibrationRequest> {
+    using ReplyType = CalibrationReply;
+  };
+
+  template <> struct MessageRequestReply<SetTileCalibrationRequest> {
+    using ReplyType = CalibrationReply;
+  };
+
+  template <> struct MessageRequestReply<GetCalibrationRequest> {
+    using ReplyType = CalibrationReply;
+  };
 } // namespace
 
 template <IsMessage RequestT>
@@ -1,13 +1,82 @@
+#include <algorithm>
 #include <argparse/argparse.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <plog/Appenders/ColorConsoleAppender.h>
 #include <plog/Formatters/TxtFormatter.h>
 #include <plog/Init.h>
 #include <plog/Log.h>
+#include <thread>
 #include <vector>
 #include <zmq.hpp>
 
 #include "consts.hpp"
+#include "delta_frame.hpp"
+#include "frame_compression.hpp"
+#include "frame_hash.hpp"
+#include "frame_messages.hpp"
+#include "frame_socket.hpp"
+#include "pixel_format.hpp"
+#include "shm_ring.hpp"
+#include "spsc_ring.hpp"
+#include "stats.hpp"
+
+using Clock = std::chrono::steady_clock;
+using pixel_format::PixelFormat;
+
+static PixelFormat get_pixel_format(const argparse::ArgumentParser &program,
+                                    const std::string &arg) {
+  const auto value = program.get<std::string>(arg);
+  const auto format = pixel_format::from_name(value);
+  if (!format) {
+    throw std::runtime_error("Invalid pixel format for " + arg + ": " + value);
+  }
+
+  return *format;
+}
+
+// Reads a palette file of up to 256 RGB24 colors and builds the message uploading it.
+static std::vector<std::byte> read_palette(const std::string &path,
+                                           pixel_format::Palette &palette) {
+  std::ifstream file(path, std::ios::binary);
+  const std::vector<char> colors(std::istreambuf_iterator<char>(file), {});
+  if (!file.eof() || colors.size() % 3 != 0 || colors.size() > palette.size() * 3) {
+    throw std::runtime_error("Palette must be a file of up to 256 RGB24 colors: " + path);
+  }
+
+  const lmz::PaletteFrameHeader header = {.entry_count =
+                                              static_cast<std::uint16_t>(colors.size() / 3)};
+  std::vector<std::byte> message(sizeof(header) + colors.size());
+  std::memcpy(message.data(), &header, sizeof(header));
+  std::memcpy(message.data() + sizeof(header), colors.data(), colors.size());
+
+  for (auto i = 0; i < header.entry_count; ++i) {
+    const auto *rgb = reinterpret_cast<const std::uint8_t *>(colors.data()) + i * 3;
+    palette[i] = (rgb[0] << 0) | (rgb[1] << 8) | (rgb[2] << 16);
+  }
+
+  return message;
+}
+
+// Builds a compressed message wrapping `message` into `out`. Returns false if compressing didn't
+// make it any smaller.
+static bool compress_message(zmq::const_buffer message, std::vector<std::byte> &out) {
+  const lmz::CompressedFrameHeader header = {
+      .compression = lmz::Compression::Lz,
+      .size = static_cast<std::uint32_t>(message.size()),
+  };
+
+  out.resize(sizeof(header));
+  std::memcpy(out.data(), &header, sizeof(header));
+  frame_compression::compress({static_cast<const std::byte *>(message.data()), message.size()},
+                              out);
+
+  return out.size() < message.size();
+}
 
 int main(int argc, char *argv[]) {
   static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
@@ -19,9 +88,87 @@ int main(int argc, char *argv[]) {
   program.add_argument("-w", "--width").default_value(32).scan<'i', int>();
   program.add_argument("-h", "--height").default_value(32).scan<'i', int>();
   program.add_argument("-f", "--frame-endpoint").default_value(consts::default_frame_endpoint);
+  frame_socket::add_arguments(program);
+  program.add_argument("--shm")
+      .help("Write frames straight into a server on this host started with --shm, instead of "
+            "sending them to the frame endpoint")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--shm-name").default_value(std::string(consts::default_shm_name));
+  program.add_argument("--delta")
+      .help("Only send the regions that changed since the previous frame")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--keyframe-interval")
+      .help("With --delta, send a full frame every this many frames")
+      .default_value(100)
+      .scan<'i', int>();
+  program.add_argument("--input-format")
+      .help("Pixel format read from stdin: rgba32, rgb24, rgb565, palette8 or gray8")
+      .default_value(std::string("rgba32"));
+  program.add_argument("--wire-format")
+      .help("Pixel format sent to the server: rgba32, rgb24, rgb565, palette8 or gray8")
+      .default_value(std::string("rgba32"));
+  program.add_argument("--palette").help("RGB24 palette file for palette8 input");
+  program.add_argument("--compress")
+      .help("Compress frames, worthwhile over slow links such as tcp:// on Wi-Fi")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--no-frame-cache")
+      .help("Always send frames in full, instead of referring to recently sent ones by hash")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--cached-frames")
+      .help("How many recently sent frames to refer to by hash, ideally no more than fit in the "
+            "server's --frame-cache-mb")
+      .default_value(256)
+      .scan<'i', int>();
+  program.add_argument("--fps")
+      .help("Send at most this many frames per second, dropping frames that fall behind")
+      .default_value(0.0)
+      .scan<'g', double>();
+  program.add_argument("--ring-size")
+      .help("Number of frames read ahead of the one being sent")
+      .default_value(4)
+      .scan<'i', int>();
+  program.add_argument("--stats")
+      .help("Print a summary of frame counts and timings at exit")
+      .default_value(false)
+      .implicit_value(true);
 
+  frame_socket::Options frame_socket_options;
+  PixelFormat input_format, wire_format;
   try {
     program.parse_args(argc, argv);
+    frame_socket_options = frame_socket::options_from_args(program);
+    input_format = get_pixel_format(program, "--input-format");
+    wire_format = get_pixel_format(program, "--wire-format");
+
+    if (wire_format == PixelFormat::Palette8 && input_format != PixelFormat::Palette8) {
+      throw std::runtime_error("palette8 can only be sent from palette8 input");
+    }
+
+    if (program.get<bool>("--delta") && wire_format != PixelFormat::Rgba32) {
+      throw std::runtime_error("--delta needs the rgba32 wire format");
+    }
+
+    if (program.get<bool>("--delta") &&
+        (frame_socket_options.mode == frame_socket::Mode::PubSub ||
+         frame_socket_options.drop_policy == frame_socket::DropPolicy::DropOldest)) {
+      throw std::runtime_error("--delta needs a frame socket that does not silently drop frames");
+    }
+
+    if (program.get<bool>("--shm") &&
+        (wire_format != PixelFormat::Rgba32 || program.get<bool>("--delta") ||
+         program.get<bool>("--compress"))) {
+      throw std::runtime_error("--shm frames are always plain rgba32, without --delta or "
+                               "--compress");
+    }
+
+    if (program.get<double>("--fps") < 0 || program.get<int>("--ring-size") < 1 ||
+        program.get<int>("--cached-frames") < 0) {
+      throw std::runtime_error("--fps, --ring-size and --cached-frames must be positive");
+    }
   } catch (const std::runtime_error &err) {
     std::cerr << err.what() << std::endl;
     std::cerr << program;
@@ -31,28 +178,306 @@ int main(int argc, char *argv[]) {
   int width = program.get<int>("--width");
   int height = program.get<int>("--height");
   std::string frame_endpoint = program.get<std::string>("--frame-endpoint");
+  bool delta = program.get<bool>("--delta");
+  int keyframe_interval = program.get<int>("--keyframe-interval");
+  bool compress = program.get<bool>("--compress");
+  double fps = program.get<double>("--fps");
+  int ring_size = program.get<int>("--ring-size");
+  std::size_t cached_frames = program.get<int>("--cached-frames");
+  bool print_stats = program.get<bool>("--stats");
+
+  auto palette = pixel_format::default_palette();
+  std::vector<std::byte> palette_message;
+  if (auto palette_path = program.present("--palette")) {
+    try {
+      palette_message = read_palette(*palette_path, palette);
+    } catch (const std::runtime_error &err) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+  }
+
+  std::optional<lmz::ShmRing> shm;
+  if (program.get<bool>("--shm")) {
+    const auto shm_name = program.get<std::string>("--shm-name");
+    try {
+      shm = lmz::ShmRing::open(shm_name);
+    } catch (const std::runtime_error &err) {
+      std::cerr << err.what() << " (is the server running with --shm?)" << std::endl;
+      return 1;
+    }
+
+    if (shm->width() != width || shm->height() != height) {
+      std::cerr << "The server's shared memory frames are " << shm->width() << "x"
+                << shm->height() << ", not " << width << "x" << height << std::endl;
+      return 1;
+    }
+  }
 
   zmq::context_t ctx;
-  zmq::socket_t sock(ctx, zmq::socket_type::req);
-  sock.connect(frame_endpoint);
+  auto sock = frame_socket::make_sender(ctx, frame_socket_options);
+  if (!shm) {
+    sock.connect(frame_endpoint);
+  }
+
+  const std::size_t pixel_count = width * height;
+  const std::size_t frame_size = pixel_count * consts::pixel_size;
+  const std::size_t input_frame_size = pixel_count * pixel_format::bytes_per_pixel(input_format);
+
+  std::vector<std::byte> frame(frame_size);
+  std::vector<std::byte> previous_frame(frame_size);
+  std::vector<std::byte> delta_message;
+  std::vector<std::byte> wire_pixels;
+  std::vector<std::byte> pixels_message;
+  std::vector<std::byte> compressed_message;
+  std::vector<std::byte> cacheable_message;
+  int frames_since_keyframe = keyframe_interval;
+
+  // Only REQ/REP hears about cache misses, so only then may frames be sent by hash. The server
+  // checks the hash against the RGBA32 frame it ends up with, so that's what gets hashed.
+  const auto frame_cache = !program.get<bool>("--no-frame-cache") && !shm &&
+                           frame_socket_options.mode == frame_socket::Mode::ReqRep &&
+                           cached_frames > 0;
+  // Hashes of the frames the server should still have, most recently sent last.
+  std::vector<lmz::FrameHash> sent_hashes;
+
+  if (shm) {
+    PLOG_INFO << "Writing frames to shared memory " << program.get<std::string>("--shm-name");
+  } else {
+    PLOG_INFO << "Sending frames to " << frame_endpoint << " ("
+              << frame_socket::name(frame_socket_options.mode) << ")";
+  }
+  PLOG_INFO << "Expected frame size: " << input_frame_size << " bytes" << " (" << width << "x"
+            << height << " " << pixel_format::name(input_format) << "), sending as "
+            << pixel_format::name(wire_format);
+
+  if (wire_format == PixelFormat::Palette8 && !palette_message.empty()) {
+    frame_socket::send_frame(sock, frame_socket_options,
+                             zmq::const_buffer(palette_message.data(), palette_message.size()));
+  }
+
+  // Read frames on their own thread, so reading the next one overlaps sending the last one.
+  lmz::SpscRing<std::vector<std::byte>> ring(ring_size, std::vector<std::byte>(input_frame_size));
+  std::uint64_t frames_read = 0;
+  std::uint64_t reader_stalls = 0;
 
-  size_t frame_size = width * height * consts::pixel_size;
-  std::vector<char> frame(frame_size);
+  std::thread reader([&] {
+    while (true) {
+      auto *slot = ring.write_slot();
+      if (!slot) {
+        reader_stalls++;
+        ring.wait_for_space();
+        continue;
+      }
 
-  PLOG_INFO << "Sending frames to " << frame_endpoint;
-  PLOG_INFO << "Expected frame size: " << frame_size << " bytes" << " (" << width << "x" << height
-            << "x" << consts::bpp << ")";
+      if (!std::cin.read(reinterpret_cast<char *>(slot->data()), slot->size())) {
+        break;
+      }
 
-  while (std::cin.read(frame.data(), frame_size)) {
-    if (std::cin.eof()) {
-      break;
+      frames_read++;
+      ring.push();
+    }
+
+    ring.close();
+  });
+
+  std::uint64_t frames_sent = 0;
+  std::uint64_t frames_dropped = 0;
+  std::uint64_t frames_late = 0;
+  std::uint64_t frames_superseded = 0;
+  std::uint64_t frames_by_hash = 0;
+  std::uint64_t cache_misses = 0;
+  std::uint64_t sender_stalls = 0;
+  stats::Histogram send_time;
+
+  const auto interval = fps > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(1.0 / fps))
+                                : Clock::duration::zero();
+  const auto start = Clock::now();
+  auto next_send = start;
+
+  // When input is what holds us back, start pacing afresh instead of bursting to catch up.
+  const auto pace_next = [&] {
+    next_send += interval;
+    if (ring.size() == 0) {
+      next_send = std::max(next_send, Clock::now());
+    }
+  };
+
+  while (true) {
+    auto *slot = ring.read_slot();
+    if (!slot) {
+      sender_stalls++;
+      if (!ring.wait_for_data()) {
+        break;
+      }
+      continue;
+    }
+
+    if (interval > Clock::duration::zero()) {
+      // More than a whole interval behind with a newer frame already waiting, so skip this one.
+      if (Clock::now() > next_send + interval && ring.size() > 1) {
+        frames_late++;
+        next_send += interval;
+        ring.pop();
+        continue;
+      }
+
+      std::this_thread::sleep_until(next_send);
+    }
+
+    const auto &input = *slot;
+    if (shm) {
+      // Decode straight into the shared slot, the server renders from there.
+      const auto send_start = Clock::now();
+      const auto target = shm->write_frame();
+      if (input_format == PixelFormat::Rgba32) {
+        std::copy(input.begin(), input.end(), target.begin());
+      } else {
+        pixel_format::decode(input_format, input, reinterpret_cast<std::uint32_t *>(target.data()),
+                             pixel_count, palette);
+      }
+
+      if (shm->publish()) {
+        frames_superseded++;
+      }
+      frames_sent++;
+      send_time.record(Clock::now() - send_start);
+
+      ring.pop();
+      pace_next();
+      continue;
+    }
+
+    auto *frame_pixels = reinterpret_cast<std::uint32_t *>(frame.data());
+    if (input_format == PixelFormat::Rgba32) {
+      std::copy(input.begin(), input.end(), frame.begin());
+    } else {
+      // Even when the input goes out as is, the hash and any fallback to a plain frame need it.
+      pixel_format::decode(input_format, input, frame_pixels, pixel_count, palette);
+    }
+
+    std::optional<lmz::FrameHash> hash;
+    auto sent = sent_hashes.end();
+    if (frame_cache) {
+      hash = frame_hash::hash(frame);
+      sent = std::find(sent_hashes.begin(), sent_hashes.end(), *hash);
+    }
+
+    if (sent != sent_hashes.end()) {
+      std::rotate(sent, sent + 1, sent_hashes.end());
+
+      const auto send_start = Clock::now();
+      const auto shown = frame_socket::send_cached_frame(sock, frame_socket_options, *hash);
+      send_time.record(Clock::now() - send_start);
+
+      if (!shown) {
+        PLOG_DEBUG << "Dropped frame, server is not keeping up";
+        frames_dropped++;
+        frames_since_keyframe = keyframe_interval;
+        ring.pop();
+        pace_next();
+        continue;
+      }
+
+      if (*shown) {
+        frames_sent++;
+        frames_by_hash++;
+        ring.pop();
+        std::swap(frame, previous_frame);
+        pace_next();
+        continue;
+      }
+
+      // The server has evicted it since, so send it in full after all.
+      cache_misses++;
+      sent_hashes.pop_back();
     }
 
     zmq::const_buffer req(frame.data(), frame_size);
-    sock.send(req, zmq::send_flags::none);
+    if (wire_format != PixelFormat::Rgba32) {
+      if (input_format == wire_format) {
+        wire_pixels.assign(input.begin(), input.end());
+      } else {
+        pixel_format::encode(wire_format, {frame_pixels, pixel_count}, wire_pixels);
+      }
+
+      const lmz::PixelsFrameHeader header = {.format = wire_format};
+      pixels_message.resize(sizeof(header) + wire_pixels.size());
+      std::memcpy(pixels_message.data(), &header, sizeof(header));
+      std::copy(wire_pixels.begin(), wire_pixels.end(), pixels_message.begin() + sizeof(header));
+      req = zmq::const_buffer(pixels_message.data(), pixels_message.size());
+    } else if (delta && frames_since_keyframe < keyframe_interval &&
+               delta_frame::encode(previous_frame, frame, width, height, delta_message)) {
+      req = zmq::const_buffer(delta_message.data(), delta_message.size());
+      frames_since_keyframe++;
+    } else {
+      frames_since_keyframe = 0;
+    }
+
+    // The server reads any message the size of a plain frame as one, so whatever is sent must
+    // differ from that once it's wrapped. A plain frame always does.
+    const auto wrapped_size = [&](std::size_t size) {
+      return size + (hash ? sizeof(lmz::CacheableFrameHeader) : 0);
+    };
+    if (req.size() != frame_size && wrapped_size(req.size()) == frame_size) {
+      req = zmq::const_buffer(frame.data(), frame_size);
+      frames_since_keyframe = 0;
+    }
+    if (compress && compress_message(req, compressed_message) &&
+        wrapped_size(compressed_message.size()) != frame_size) {
+      req = zmq::const_buffer(compressed_message.data(), compressed_message.size());
+    }
+
+    if (hash) {
+      const lmz::CacheableFrameHeader header = {.hash = *hash};
+      cacheable_message.resize(sizeof(header) + req.size());
+      std::memcpy(cacheable_message.data(), &header, sizeof(header));
+      std::memcpy(cacheable_message.data() + sizeof(header), req.data(), req.size());
+      req = zmq::const_buffer(cacheable_message.data(), cacheable_message.size());
+    }
+
+    const auto send_start = Clock::now();
+    if (frame_socket::send_frame(sock, frame_socket_options, req)) {
+      frames_sent++;
+
+      if (hash) {
+        if (sent_hashes.size() == cached_frames) {
+          sent_hashes.erase(sent_hashes.begin());
+        }
+        sent_hashes.push_back(*hash);
+      }
+    } else {
+      PLOG_DEBUG << "Dropped frame, server is not keeping up";
+      frames_dropped++;
+
+      // The server never saw this frame, so the next delta would be against the wrong one.
+      frames_since_keyframe = keyframe_interval;
+    }
+    send_time.record(Clock::now() - send_start);
+
+    ring.pop();
+    std::swap(frame, previous_frame);
+    pace_next();
+  }
+
+  reader.join();
+
+  if (print_stats) {
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const auto send_buckets = send_time.snapshot();
 
-    zmq::message_t rep;
-    static_cast<void>(sock.recv(rep));
+    PLOG_INFO << frames_read << " frames read, " << frames_sent << " sent, " << frames_dropped
+              << " dropped by the socket, " << frames_late << " dropped late, "
+              << frames_superseded << " superseded in shared memory";
+    PLOG_INFO << frames_by_hash << " sent by hash, " << cache_misses
+              << " sent in full after a cache miss";
+    PLOG_INFO << elapsed << "s, " << frames_sent / elapsed << " fps sent";
+    PLOG_INFO << "send time p50<=" << stats::percentile_us(send_buckets, 0.5)
+              << "us p99<=" << stats::percentile_us(send_buckets, 0.99)
+              << "us max<=" << stats::percentile_us(send_buckets, 1.0) << "us";
+    PLOG_INFO << "Reader waited for the sender " << reader_stalls
+              << " times, sender waited for input " << sender_stalls << " times";
   }
 
   return 0;
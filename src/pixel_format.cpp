@@ -0,0 +1,154 @@
+#include "pixel_format.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+using pixel_format::PixelFormat;
+
+void decode_rgba32(const std::uint8_t *src, std::uint32_t *dst, std::size_t count) {
+  std::copy_n(src, count * sizeof(std::uint32_t), reinterpret_cast<std::uint8_t *>(dst));
+}
+
+void decode_rgb24(const std::uint8_t *src, std::uint32_t *dst, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i, src += 3) {
+    dst[i] = (src[0] << 0) | (src[1] << 8) | (src[2] << 16);
+  }
+}
+
+void decode_rgb565(const std::uint8_t *src, std::uint32_t *dst, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i, src += 2) {
+    const std::uint32_t pixel = src[0] | (src[1] << 8);
+    const auto r = (pixel >> 11) & 0x1F;
+    const auto g = (pixel >> 5) & 0x3F;
+    const auto b = (pixel >> 0) & 0x1F;
+
+    // Replicate the top bits into the bottom ones so full intensity maps to 255.
+    dst[i] = (((r << 3) | (r >> 2)) << 0) | (((g << 2) | (g >> 4)) << 8) |
+             (((b << 3) | (b >> 2)) << 16);
+  }
+}
+
+void decode_palette8(const std::uint8_t *src, std::uint32_t *dst, std::size_t count,
+                     const pixel_format::Palette &palette) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = palette[src[i]];
+  }
+}
+
+void decode_gray8(const std::uint8_t *src, std::uint32_t *dst, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = src[i] * 0x010101u;
+  }
+}
+
+} // namespace
+
+pixel_format::Palette pixel_format::default_palette() {
+  Palette palette;
+  for (std::uint32_t i = 0; i < palette.size(); ++i) {
+    palette[i] = i * 0x010101u;
+  }
+
+  return palette;
+}
+
+std::size_t pixel_format::bytes_per_pixel(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgba32:
+    return 4;
+  case PixelFormat::Rgb24:
+    return 3;
+  case PixelFormat::Rgb565:
+    return 2;
+  case PixelFormat::Palette8:
+  case PixelFormat::Gray8:
+    return 1;
+  }
+
+  throw std::runtime_error("Invalid pixel format");
+}
+
+const char *pixel_format::name(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgba32:
+    return "rgba32";
+  case PixelFormat::Rgb24:
+    return "rgb24";
+  case PixelFormat::Rgb565:
+    return "rgb565";
+  case PixelFormat::Palette8:
+    return "palette8";
+  case PixelFormat::Gray8:
+    return "gray8";
+  }
+
+  return "unknown";
+}
+
+std::optional<PixelFormat> pixel_format::from_name(const std::string &name) {
+  for (const auto format : {PixelFormat::Rgba32, PixelFormat::Rgb24, PixelFormat::Rgb565,
+                            PixelFormat::Palette8, PixelFormat::Gray8}) {
+    if (name == pixel_format::name(format)) {
+      return format;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void pixel_format::decode(PixelFormat format, std::span<const std::byte> src, std::uint32_t *dst,
+                          std::size_t count, const Palette &palette) {
+  if (src.size() != count * bytes_per_pixel(format)) {
+    throw std::runtime_error("Received pixels of unexpected size");
+  }
+
+  const auto *bytes = reinterpret_cast<const std::uint8_t *>(src.data());
+  switch (format) {
+  case PixelFormat::Rgba32:
+    return decode_rgba32(bytes, dst, count);
+  case PixelFormat::Rgb24:
+    return decode_rgb24(bytes, dst, count);
+  case PixelFormat::Rgb565:
+    return decode_rgb565(bytes, dst, count);
+  case PixelFormat::Palette8:
+    return decode_palette8(bytes, dst, count, palette);
+  case PixelFormat::Gray8:
+    return decode_gray8(bytes, dst, count);
+  }
+}
+
+void pixel_format::encode(PixelFormat format, std::span<const std::uint32_t> src,
+                          std::vector<std::byte> &out) {
+  out.resize(src.size() * bytes_per_pixel(format));
+  auto *dst = reinterpret_cast<std::uint8_t *>(out.data());
+
+  for (const auto pixel : src) {
+    const std::uint8_t r = (pixel >> 0) & 0xFF;
+    const std::uint8_t g = (pixel >> 8) & 0xFF;
+    const std::uint8_t b = (pixel >> 16) & 0xFF;
+
+    switch (format) {
+    case PixelFormat::Rgba32: {
+      std::copy_n(reinterpret_cast<const std::uint8_t *>(&pixel), 4, dst);
+      dst += 4;
+    } break;
+    case PixelFormat::Rgb24: {
+      *dst++ = r;
+      *dst++ = g;
+      *dst++ = b;
+    } break;
+    case PixelFormat::Rgb565: {
+      const std::uint16_t packed = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+      *dst++ = packed & 0xFF;
+      *dst++ = packed >> 8;
+    } break;
+    case PixelFormat::Gray8: {
+      // Rec. 601 luma in fixed point.
+      *dst++ = static_cast<std::uint8_t>((r * 77 + g * 150 + b * 29) >> 8);
+    } break;
+    case PixelFormat::Palette8:
+      throw std::runtime_error("Can't encode to a palette format");
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "frame_messages.hpp"
+
+// Conversion between the compact wire pixel formats and the RGBA32 frames the server renders.
+namespace pixel_format {
+
+using lmz::PixelFormat;
+
+constexpr std::size_t palette_size = 256;
+using Palette = std::array<std::uint32_t, palette_size>;
+
+// A grayscale ramp, used until a palette is uploaded.
+Palette default_palette();
+
+std::size_t bytes_per_pixel(PixelFormat format);
+
+const char *name(PixelFormat format);
+std::optional<PixelFormat> from_name(const std::string &name);
+
+// Converts `count` pixels in `format` to RGBA32. `src` must hold exactly `count` pixels.
+void decode(PixelFormat format, std::span<const std::byte> src, std::uint32_t *dst,
+            std::size_t count, const Palette &palette);
+
+// Converts RGBA32 pixels to `format`, replacing the contents of `out`. Palette8 can't be encoded
+// as that would need a quantizer.
+void encode(PixelFormat format, std::span<const std::uint32_t> src, std::vector<std::byte> &out);
+
+} // namespace pixel_format
@@ -0,0 +1,219 @@
+#include "pixel_kernel.hpp"
+
+#include <tuple>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LMZ_PIXEL_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#define LMZ_PIXEL_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using pixel_kernel::Scale;
+
+void convert_scalar(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                    const Scale &scale) {
+  pixel_kernel::convert_tables(src, dst, count, scale.tables);
+}
+
+// The vector paths all scale in 16-bit lanes and divide by 255 with (x + 1 + (x >> 8)) >> 8,
+// which is exact for every product of two bytes.
+
+#ifdef LMZ_PIXEL_KERNEL_X86
+
+__m128i div255_sse2(__m128i x) {
+  const auto one = _mm_set1_epi16(1);
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+}
+
+__m128i scale_sse2(__m128i x, __m128i brightness, __m128i temperature) {
+  return div255_sse2(_mm_mullo_epi16(div255_sse2(_mm_mullo_epi16(x, brightness)), temperature));
+}
+
+void convert_sse2(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                  const Scale &scale) {
+  const auto zero = _mm_setzero_si128();
+  const auto brightness =
+      _mm_setr_epi16(scale.brightness, scale.brightness, scale.brightness, 0, scale.brightness,
+                     scale.brightness, scale.brightness, 0);
+  const auto temperature =
+      _mm_setr_epi16(scale.r, scale.g, scale.b, 0, scale.r, scale.g, scale.b, 0);
+
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    const auto lo = scale_sse2(_mm_unpacklo_epi8(pixels, zero), brightness, temperature);
+    const auto hi = scale_sse2(_mm_unpackhi_epi8(pixels, zero), brightness, temperature);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+
+  convert_scalar(src + i, dst + i, count - i, scale);
+}
+
+__attribute__((target("avx2"))) __m256i div255_avx2(__m256i x) {
+  const auto one = _mm256_set1_epi16(1);
+  return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, one), _mm256_srli_epi16(x, 8)),
+                           8);
+}
+
+__attribute__((target("avx2"))) __m256i scale_avx2(__m256i x, __m256i brightness,
+                                                   __m256i temperature) {
+  return div255_avx2(
+      _mm256_mullo_epi16(div255_avx2(_mm256_mullo_epi16(x, brightness)), temperature));
+}
+
+__attribute__((target("avx2"))) void convert_avx2(const std::uint32_t *src, std::uint32_t *dst,
+                                                  std::size_t count, const Scale &scale) {
+  const auto zero = _mm256_setzero_si256();
+  const std::int16_t l = scale.brightness;
+  const auto brightness = _mm256_setr_epi16(l, l, l, 0, l, l, l, 0, l, l, l, 0, l, l, l, 0);
+  const std::int16_t r = scale.r, g = scale.g, b = scale.b;
+  const auto temperature = _mm256_setr_epi16(r, g, b, 0, r, g, b, 0, r, g, b, 0, r, g, b, 0);
+
+  // Unpack and pack both work within 128-bit lanes, so the pixel order comes back unchanged.
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const auto pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    const auto lo = scale_avx2(_mm256_unpacklo_epi8(pixels, zero), brightness, temperature);
+    const auto hi = scale_avx2(_mm256_unpackhi_epi8(pixels, zero), brightness, temperature);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+
+  // GCC leaves this out before the tail call, and without it every SSE instruction after us pays
+  // for the dirty upper halves, which made row-by-row conversion slower than plain SSE2.
+  _mm256_zeroupper();
+  convert_sse2(src + i, dst + i, count - i, scale);
+}
+
+#endif
+
+#ifdef LMZ_PIXEL_KERNEL_NEON
+
+uint8x8_t scale_neon(uint8x8_t x, uint8x8_t factor) {
+  const auto product = vmull_u8(x, factor);
+  const auto rounded = vaddq_u16(vaddq_u16(product, vdupq_n_u16(1)), vshrq_n_u16(product, 8));
+  return vshrn_n_u16(rounded, 8);
+}
+
+void convert_neon(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                  const Scale &scale) {
+  const std::uint8_t l = scale.brightness;
+  const std::uint8_t brightness_lanes[8] = {l, l, l, 0, l, l, l, 0};
+  const std::uint8_t temperature_lanes[8] = {scale.r, scale.g, scale.b, 0,
+                                             scale.r, scale.g, scale.b, 0};
+  const auto brightness = vld1_u8(brightness_lanes);
+  const auto temperature = vld1_u8(temperature_lanes);
+
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const auto pixels = vld1q_u8(reinterpret_cast<const std::uint8_t *>(src + i));
+    const auto lo = scale_neon(scale_neon(vget_low_u8(pixels), brightness), temperature);
+    const auto hi = scale_neon(scale_neon(vget_high_u8(pixels), brightness), temperature);
+    vst1q_u8(reinterpret_cast<std::uint8_t *>(dst + i), vcombine_u8(lo, hi));
+  }
+
+  convert_scalar(src + i, dst + i, count - i, scale);
+}
+
+#endif
+
+} // namespace
+
+void pixel_kernel::convert_tables(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                                  const color_lut::Tables &tables) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto pixel = src[i];
+    const std::uint32_t r = tables.r[(pixel >> 0) & 0xFF];
+    const std::uint32_t g = tables.g[(pixel >> 8) & 0xFF];
+    const std::uint32_t b = tables.b[(pixel >> 16) & 0xFF];
+
+    dst[i] = (r << 0) | (g << 8) | (b << 16);
+  }
+}
+
+pixel_kernel::Scale pixel_kernel::make_scale(int brightness,
+                                             const color_temp::TemperatureColor &temperature) {
+  return Scale{
+      .brightness = static_cast<std::uint8_t>(brightness),
+      .r = static_cast<std::uint8_t>(std::get<0>(temperature)),
+      .g = static_cast<std::uint8_t>(std::get<1>(temperature)),
+      .b = static_cast<std::uint8_t>(std::get<2>(temperature)),
+      .tables = color_lut::build(brightness, temperature),
+  };
+}
+
+bool pixel_kernel::is_supported(Path path) {
+  switch (path) {
+  case Path::Scalar:
+    return true;
+#ifdef LMZ_PIXEL_KERNEL_X86
+  case Path::Sse2:
+    return __builtin_cpu_supports("sse2");
+  case Path::Avx2:
+    return __builtin_cpu_supports("avx2");
+#endif
+#ifdef LMZ_PIXEL_KERNEL_NEON
+  case Path::Neon:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+pixel_kernel::ConvertFn pixel_kernel::get(Path path) {
+  switch (path) {
+#ifdef LMZ_PIXEL_KERNEL_X86
+  case Path::Sse2:
+    return convert_sse2;
+  case Path::Avx2:
+    return convert_avx2;
+#endif
+#ifdef LMZ_PIXEL_KERNEL_NEON
+  case Path::Neon:
+    return convert_neon;
+#endif
+  default:
+    return convert_scalar;
+  }
+}
+
+const char *pixel_kernel::name(Path path) {
+  switch (path) {
+  case Path::Scalar:
+    return "scalar";
+  case Path::Sse2:
+    return "sse2";
+  case Path::Avx2:
+    return "avx2";
+  case Path::Neon:
+    return "neon";
+  }
+
+  return "unknown";
+}
+
+pixel_kernel::Path pixel_kernel::best_path() {
+  static const auto path = [] {
+    for (const auto path : {Path::Avx2, Path::Neon, Path::Sse2}) {
+      if (is_supported(path)) {
+        return path;
+      }
+    }
+
+    return Path::Scalar;
+  }();
+
+  return path;
+}
+
+void pixel_kernel::convert(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                           const Scale &scale) {
+  static const auto fn = get(best_path());
+  fn(src, dst, count, scale);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "color_lut.hpp"
+#include "color_temp.hpp"
+
+namespace pixel_kernel {
+
+// Brightness and color temperature to apply to a run of RGBA32 pixels. The vector paths use the
+// factors directly, the scalar path uses the equivalent lookup tables.
+struct Scale {
+  std::uint8_t brightness;
+  std::uint8_t r;
+  std::uint8_t g;
+  std::uint8_t b;
+  color_lut::Tables tables;
+};
+
+Scale make_scale(int brightness, const color_temp::TemperatureColor &temperature);
+
+enum class Path {
+  Scalar,
+  Sse2,
+  Avx2,
+  Neon,
+};
+
+// Converts `count` RGBA32 pixels to scaled RGB, written as 32-bit pixels with the alpha byte
+// cleared. Every path produces output bit-identical to the scalar one.
+using ConvertFn = void (*)(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                           const Scale &scale);
+
+bool is_supported(Path path);
+ConvertFn get(Path path);
+const char *name(Path path);
+
+// The fastest path supported by the running CPU, picked once on first use.
+Path best_path();
+
+void convert(const std::uint32_t *src, std::uint32_t *dst, std::size_t count, const Scale &scale);
+
+// The scalar path on its own tables, for curves that aren't a plain scale factor.
+void convert_tables(const std::uint32_t *src, std::uint32_t *dst, std::size_t count,
+                    const color_lut::Tables &tables);
+
+} // namespace pixel_kernel
@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Init.h>
+#include <plog/Log.h>
+#include <zmq.hpp>
+
+#include "consts.hpp"
+#include "frame_decoder.hpp"
+#include "frame_messages.hpp"
+#include "frame_socket.hpp"
+#include "stats.hpp"
+#include "tile_layout.hpp"
+#include "triple_buffer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static volatile std::sig_atomic_t interrupted = 0;
+
+// Which sequenced tile each node has finished with, so a commit can wait for all of them. Only
+// used with a sync endpoint.
+struct SyncProgress {
+  struct Done {
+    std::uint32_t sequence;
+    Clock::time_point time;
+    bool sent;
+  };
+
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+// Sends one node's tiles from its own thread. The receiver only ever hands over the newest tile,
+// so a slow or unreachable node misses tiles instead of holding up the others.
+class NodeSender {
+public:
+  NodeSender(zmq::context_t &ctx, const tile_layout::Node &node,
+             const frame_socket::Options &options, std::chrono::milliseconds timeout,
+             SyncProgress *progress)
+      : node(node), options(options), sock(frame_socket::make_sender(ctx, options)),
+        progress(progress), header_size(progress ? sizeof(lmz::SequencedFrameHeader) : 0),
+        stopping(false), sent(0), superseded(0), failed(0) {
+    sock.set(zmq::sockopt::linger, 0);
+    sock.set(zmq::sockopt::sndtimeo, static_cast<int>(timeout.count()));
+    sock.set(zmq::sockopt::rcvtimeo, static_cast<int>(timeout.count()));
+    if (options.mode == frame_socket::Mode::ReqRep) {
+      // Lets the next tile go out after a reply timed out, and discards the late reply.
+      sock.set(zmq::sockopt::req_relaxed, true);
+      sock.set(zmq::sockopt::req_correlate, true);
+    }
+    sock.connect(node.endpoint);
+
+    const auto size = header_size + node.width * node.height * consts::pixel_size;
+    tiles.reset(Tile{.message = std::vector<std::byte>(size), .sequence = 0});
+    thread = std::thread(&NodeSender::run, this);
+  }
+
+  ~NodeSender() { stop(); }
+
+  NodeSender(const NodeSender &) = delete;
+  NodeSender &operator=(const NodeSender &) = delete;
+
+  const tile_layout::Node &layout() const { return node; }
+
+  // Receiver side. Cut the next tile into this, then publish it.
+  std::uint32_t *tile() {
+    return reinterpret_cast<std::uint32_t *>(tiles.write_slot().message.data() + header_size);
+  }
+  void publish(std::uint32_t sequence) {
+    auto &tile = tiles.write_slot();
+    tile.sequence = sequence;
+    if (progress) {
+      const lmz::SequencedFrameHeader header = {.sequence = sequence};
+      std::memcpy(tile.message.data(), &header, sizeof(header));
+    }
+
+    if (tiles.publish()) {
+      superseded++;
+    }
+  }
+
+  // The last sequenced tile this node was done with. Needs the progress mutex.
+  const std::optional<SyncProgress::Done> &done() const { return last_done; }
+
+  // How long after the first node each commit found this one ready. Only recorded for tiles
+  // that were sent.
+  void record_ready_skew(Clock::duration skew) { ready_skew.record(skew); }
+
+  // Call after shutting down the context, so a send blocked on the node gives up too.
+  void stop() {
+    if (!thread.joinable()) {
+      return;
+    }
+
+    stopping = true;
+    tiles.publish();
+    thread.join();
+  }
+
+  void report() const {
+    const auto buckets = send_time.snapshot();
+    PLOG_INFO << node.endpoint << ": " << sent << " sent, " << superseded << " superseded, "
+              << failed << " failed, send p50<=" << stats::percentile_us(buckets, 0.5)
+              << "us p99<=" << stats::percentile_us(buckets, 0.99) << "us";
+    if (progress) {
+      const auto skew = ready_skew.snapshot();
+      PLOG_INFO << node.endpoint << ": ready skew p50<=" << stats::percentile_us(skew, 0.5)
+                << "us p99<=" << stats::percentile_us(skew, 0.99) << "us";
+    }
+  }
+
+private:
+  void run() {
+    try {
+      while (true) {
+        tiles.wait();
+        if (stopping) {
+          return;
+        }
+
+        tiles.consume();
+        const auto &tile = tiles.read_slot();
+        const auto buffer = zmq::const_buffer(tile.message.data(), tile.message.size());
+        const auto start = Clock::now();
+        const auto ok = frame_socket::send_frame(sock, options, buffer);
+        const auto end = Clock::now();
+        if (ok) {
+          sent++;
+          send_time.record(end - start);
+        } else {
+          failed++;
+        }
+
+        if (progress) {
+          {
+            const std::lock_guard<std::mutex> guard(progress->mutex);
+            last_done = SyncProgress::Done{.sequence = tile.sequence, .time = end, .sent = ok};
+          }
+          progress->cv.notify_all();
+        }
+      }
+    } catch (const zmq::error_t &err) {
+      if (err.num() != ETERM) {
+        throw;
+      }
+    }
+  }
+
+  // A tile message, starting with a SequencedFrameHeader when syncing.
+  struct Tile {
+    std::vector<std::byte> message;
+    std::uint32_t sequence;
+  };
+
+  tile_layout::Node node;
+  frame_socket::Options options;
+  zmq::socket_t sock;
+  SyncProgress *progress;
+  std::size_t header_size;
+  lmz::TripleBuffer<Tile> tiles;
+  std::thread thread;
+  std::atomic<bool> stopping;
+  std::optional<SyncProgress::Done> last_done;
+
+  std::atomic<std::uint64_t> sent;
+  std::atomic<std::uint64_t> superseded;
+  std::atomic<std::uint64_t> failed;
+  stats::Histogram send_time;
+  stats::Histogram ready_skew;
+};
+
+// Publishes a commit for each frame once every node has its tile, or once the commit timeout
+// runs out, telling the servers to present it together. A frame superseded before every node had
+// it gets no commit.
+class Committer {
+public:
+  Committer(zmq::context_t &ctx, const std::string &endpoint, std::chrono::milliseconds timeout,
+            SyncProgress &progress, const std::vector<std::unique_ptr<NodeSender>> &nodes)
+      : sock(ctx, zmq::socket_type::pub), timeout(timeout), progress(progress), nodes(nodes),
+        stopping(false), latest(), committed(0), timed_out(0), skipped(0) {
+    sock.set(zmq::sockopt::linger, 0);
+    sock.bind(endpoint);
+    thread = std::thread(&Committer::run, this);
+  }
+
+  ~Committer() { stop(); }
+
+  Committer(const Committer &) = delete;
+  Committer &operator=(const Committer &) = delete;
+
+  // Call once frame `sequence` has been handed to every node.
+  void frame_published(std::uint32_t sequence) {
+    {
+      const std::lock_guard<std::mutex> guard(progress.mutex);
+      latest = Frame{.sequence = sequence, .published = Clock::now()};
+    }
+    progress.cv.notify_all();
+  }
+
+  void stop() {
+    if (!thread.joinable()) {
+      return;
+    }
+
+    {
+      const std::lock_guard<std::mutex> guard(progress.mutex);
+      stopping = true;
+    }
+    progress.cv.notify_all();
+    thread.join();
+  }
+
+  void report() const {
+    PLOG_INFO << committed << " commits, " << timed_out << " without every node, " << skipped
+              << " frames superseded before every node had them";
+  }
+
+private:
+  struct Frame {
+    std::uint32_t sequence;
+    Clock::time_point published;
+  };
+
+  // Whether every node is done with `sequence` or has moved past it. Needs the progress mutex.
+  bool all_done(std::uint32_t sequence) const {
+    return std::all_of(nodes.begin(), nodes.end(), [sequence](const auto &node) {
+      const auto &done = node->done();
+      return done && !lmz::sequence_after(sequence, done->sequence);
+    });
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(progress.mutex);
+    std::optional<std::uint32_t> last_commit;
+    while (true) {
+      progress.cv.wait(lock, [&] {
+        return stopping || (latest && latest->sequence != last_commit);
+      });
+      if (stopping) {
+        return;
+      }
+
+      const auto frame = *latest;
+      progress.cv.wait_until(lock, frame.published + timeout, [&] {
+        return stopping || latest->sequence != frame.sequence || all_done(frame.sequence);
+      });
+      if (stopping) {
+        return;
+      }
+
+      const auto complete = all_done(frame.sequence);
+      if (!complete && latest->sequence != frame.sequence) {
+        skipped++;
+        continue;
+      }
+
+      const lmz::SyncCommit commit = {.sequence = frame.sequence};
+      sock.send(zmq::const_buffer(&commit, sizeof(commit)), zmq::send_flags::dontwait);
+      last_commit = frame.sequence;
+      committed++;
+      if (!complete) {
+        timed_out++;
+      }
+
+      record_skew(frame.sequence);
+    }
+  }
+
+  void record_skew(std::uint32_t sequence) {
+    std::optional<Clock::time_point> first;
+    for (const auto &node : nodes) {
+      const auto &done = node->done();
+      if (done && done->sent && done->sequence == sequence) {
+        first = first ? std::min(*first, done->time) : done->time;
+      }
+    }
+
+    for (const auto &node : nodes) {
+      const auto &done = node->done();
+      if (done && done->sent && done->sequence == sequence) {
+        node->record_ready_skew(done->time - *first);
+      }
+    }
+  }
+
+  zmq::socket_t sock;
+  std::chrono::milliseconds timeout;
+  SyncProgress &progress;
+  const std::vector<std::unique_ptr<NodeSender>> &nodes;
+  std::thread thread;
+
+  // Guarded by the progress mutex.
+  bool stopping;
+  std::optional<Frame> latest;
+
+  std::atomic<std::uint64_t> committed;
+  std::atomic<std::uint64_t> timed_out;
+  std::atomic<std::uint64_t> skipped;
+};
+
+int main(int argc, char *argv[]) {
+  static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
+  plog::init(plog::info, &consoleAppender);
+
+  argparse::ArgumentParser program("led-matrix-zmq-proxy");
+  program.add_description("Receives frames for one large canvas and sends each part of it to the "
+                          "led-matrix-zmq-server showing it");
+
+  program.add_argument("-l", "--layout").help("Layout file listing the nodes").required();
+  program.add_argument("-f", "--frame-endpoint").default_value(consts::default_frame_endpoint);
+  frame_socket::add_arguments(program);
+  frame_socket::add_arguments(program, "node");
+  program.add_argument("--node-timeout-ms")
+      .help("Give up on a tile a node hasn't taken or acknowledged after this long")
+      .default_value(1000)
+      .scan<'i', int>();
+  program.add_argument("--frame-cache-mb")
+      .help("Memory for recently received frames that producers can send again by hash")
+      .default_value(16)
+      .scan<'i', int>();
+  program.add_argument("--sync-endpoint")
+      .help("Publish a commit here once every node has a frame, for servers started with "
+            "--sync-endpoint to present it together");
+  program.add_argument("--commit-timeout-ms")
+      .help("Commit a frame this long after it was received even if some nodes don't have it")
+      .default_value(50)
+      .scan<'i', int>();
+  program.add_argument("--stats-interval")
+      .help("Log per-node statistics every this many seconds, 0 for only at exit")
+      .default_value(10)
+      .scan<'i', int>();
+
+  tile_layout::Layout layout;
+  frame_socket::Options input_options, node_options;
+  try {
+    program.parse_args(argc, argv);
+    layout = tile_layout::load(program.get<std::string>("--layout"));
+    input_options = frame_socket::options_from_args(program);
+    node_options = frame_socket::options_from_args(program, "node");
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  const auto timeout = std::chrono::milliseconds(program.get<int>("--node-timeout-ms"));
+  const auto stats_interval = std::chrono::seconds(program.get<int>("--stats-interval"));
+  const auto frame_size = layout.width * layout.height * consts::pixel_size;
+  const auto sync_endpoint = program.present("--sync-endpoint");
+
+  std::signal(SIGINT, [](int) { interrupted = 1; });
+  std::signal(SIGTERM, [](int) { interrupted = 1; });
+
+  zmq::context_t ctx;
+  SyncProgress progress;
+  std::vector<std::unique_ptr<NodeSender>> nodes;
+  for (const auto &node : layout.nodes) {
+    PLOG_INFO << "Sending " << node.width << "x" << node.height << " at " << node.x << ","
+              << node.y << " to " << node.endpoint;
+    nodes.push_back(std::make_unique<NodeSender>(ctx, node, node_options, timeout,
+                                                 sync_endpoint ? &progress : nullptr));
+  }
+
+  std::unique_ptr<Committer> committer;
+  if (sync_endpoint) {
+    const auto commit_timeout = std::chrono::milliseconds(program.get<int>("--commit-timeout-ms"));
+    committer = std::make_unique<Committer>(ctx, *sync_endpoint, commit_timeout, progress, nodes);
+    PLOG_INFO << "Publishing commits on " << *sync_endpoint;
+  }
+
+  const auto frame_endpoint = program.get<std::string>("--frame-endpoint");
+  auto sock = frame_socket::make_receiver(ctx, input_options);
+  sock.set(zmq::sockopt::linger, 0);
+  sock.bind(frame_endpoint);
+  PLOG_INFO << "Listening for " << layout.width << "x" << layout.height << " frames on "
+            << frame_endpoint;
+
+  std::vector<std::byte> message(frame_size * consts::max_frame_message_factor);
+  std::vector<std::byte> canvas(frame_size);
+  lmz::FrameDecoder decoder(
+      layout.width, layout.height,
+      static_cast<std::size_t>(std::max(program.get<int>("--frame-cache-mb"), 0)) << 20);
+  std::uint64_t received = 0, rejected = 0;
+  std::uint32_t sequence = 0;
+
+  const auto report = [&] {
+    PLOG_INFO << received << " frames received, " << rejected << " rejected";
+    if (committer) {
+      committer->report();
+    }
+    for (const auto &node : nodes) {
+      node->report();
+    }
+  };
+
+  auto last_report = Clock::now();
+  while (!interrupted) {
+    zmq::recv_buffer_result_t res;
+    std::optional<lmz::FrameHash> cached_hash;
+    try {
+      res = sock.recv(zmq::mutable_buffer(message.data(), message.size()), zmq::recv_flags::none);
+
+      // Cache misses go back to the producer, so those are answered after decoding.
+      if (res && !res->truncated()) {
+        cached_hash = lmz::get_cached_frame_hash({message.data(), res->size});
+      }
+      if (!cached_hash) {
+        frame_socket::acknowledge_frame(sock, input_options);
+      }
+    } catch (const zmq::error_t &err) {
+      if (err.num() == EINTR) {
+        continue;
+      }
+      throw;
+    }
+
+    if (!res) {
+      continue;
+    }
+
+    if (res->truncated()) {
+      PLOG_ERROR << "Received frame message larger than " << message.size() << " bytes";
+      rejected++;
+      continue;
+    }
+
+    try {
+      const auto data = std::span<const std::byte>(message.data(), res->size);
+      const auto result = decoder.decode(data, canvas);
+      if (cached_hash) {
+        frame_socket::acknowledge_cached_frame(sock, input_options, *cached_hash,
+                                               decoder.cache_hit().value_or(false));
+      }
+      if (result == lmz::FrameDecoder::Result::NoFrame) {
+        continue;
+      }
+    } catch (const std::runtime_error &err) {
+      PLOG_ERROR << err.what();
+      rejected++;
+      continue;
+    }
+
+    // Unchanged frames are forwarded too, so a node that missed the last one catches up.
+    received++;
+    sequence++;
+    const auto *pixels = reinterpret_cast<const std::uint32_t *>(canvas.data());
+    for (auto &node : nodes) {
+      tile_layout::cut(pixels, layout.width, node->layout(), node->tile());
+      node->publish(sequence);
+    }
+    if (committer) {
+      committer->frame_published(sequence);
+    }
+
+    if (stats_interval.count() > 0 && Clock::now() - last_report >= stats_interval) {
+      report();
+      last_report = Clock::now();
+    }
+  }
+
+  sock.close();
+  if (committer) {
+    committer->stop();
+  }
+  ctx.shutdown();
+  for (auto &node : nodes) {
+    node->stop();
+  }
+  report();
+
+  return 0;
+}
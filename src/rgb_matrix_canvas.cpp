@@ -0,0 +1,31 @@
+#include "rgb_matrix_canvas.hpp"
+
+lmz::RgbMatrixCanvas::RgbMatrixCanvas(rgb_matrix::RGBMatrix *matrix)
+    : matrix(matrix), canvases({matrix->CreateFrameCanvas(), nullptr}), back_index(0) {
+  matrix->set_luminance_correct(true);
+  canvases[0]->set_luminance_correct(true);
+}
+
+int lmz::RgbMatrixCanvas::width() const { return matrix->width(); }
+int lmz::RgbMatrixCanvas::height() const { return matrix->height(); }
+
+int lmz::RgbMatrixCanvas::buffer_count() const { return canvases.size(); }
+int lmz::RgbMatrixCanvas::back_buffer() const { return back_index; }
+
+void lmz::RgbMatrixCanvas::set_row(int y, std::span<const std::uint32_t> pixels) {
+  // The library has no call taking a whole row, so this is still one call per pixel. Naming
+  // FrameCanvas's own SetPixel at least makes it a direct call rather than a virtual one.
+  auto *canvas = canvases[back_index];
+  for (auto x = 0; x < static_cast<int>(pixels.size()); ++x) {
+    const auto pixel = pixels[x];
+    canvas->rgb_matrix::FrameCanvas::SetPixel(x, y, (pixel >> 0) & 0xFF, (pixel >> 8) & 0xFF,
+                                              (pixel >> 16) & 0xFF);
+  }
+}
+
+void lmz::RgbMatrixCanvas::present() {
+  // The first swap hands back the matrix's own initial canvas, which then joins the pool.
+  auto *previous = matrix->SwapOnVSync(canvases[back_index]);
+  back_index ^= 1;
+  canvases[back_index] = previous;
+}
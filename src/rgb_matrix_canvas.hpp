@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+
+#include <led-matrix.h>
+
+#include "canvas.hpp"
+
+namespace lmz {
+
+// Draws into offscreen rpi-rgb-led-matrix FrameCanvases and swaps them in on vsync, so the
+// refresh thread never scans out a half-written frame.
+class RgbMatrixCanvas : public Canvas {
+public:
+  explicit RgbMatrixCanvas(rgb_matrix::RGBMatrix *matrix);
+
+  int width() const override;
+  int height() const override;
+
+  int buffer_count() const override;
+  int back_buffer() const override;
+
+  void set_row(int y, std::span<const std::uint32_t> pixels) override;
+  void present() override;
+
+private:
+  rgb_matrix::RGBMatrix *matrix;
+
+  // The canvas given back by each swap is the next one drawn into, so two is all it takes.
+  std::array<rgb_matrix::FrameCanvas *, 2> canvases;
+  int back_index;
+};
+
+} // namespace lmz
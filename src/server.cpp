@@ -0,0 +1,1243 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <utility>
+
+#include <plog/Log.h>
+
+#include "alloc_counter.hpp"
+#include "easing.hpp"
+#include "frame_decoder.hpp"
+#include "frame_messages.hpp"
+#include "test_pattern.hpp"
+
+lmz::StatsArgs lmz::Server::Counters::snapshot() const {
+  StatsArgs args = {
+      .frames_received = frames_received,
+      .frames_rendered = frames_rendered,
+      .frames_rejected = frames_rejected,
+      .frames_dropped = frames_dropped,
+      .frames_skipped = frames_skipped,
+      .bytes_in = bytes_in,
+      .control_requests = control_requests,
+      .redraws_coalesced = redraws_coalesced,
+      .frames_synced = frames_synced,
+      .sync_missed = sync_missed,
+      .sync_timeouts = sync_timeouts,
+      .cache_hits = cache_hits,
+      .cache_misses = cache_misses,
+      .frame_path_allocations = frame_path_allocations,
+      .allocations_counted = alloc_counter::enabled(),
+      .display_latency_us = {},
+      .render_time_us = {},
+      .sync_skew_us = {},
+  };
+  stats::copy_to_message(display_latency.snapshot(), args.display_latency_us);
+  stats::copy_to_message(render_time.snapshot(), args.render_time_us);
+  stats::copy_to_message(sync_skew.snapshot(), args.sync_skew_us);
+
+  return args;
+}
+
+void lmz::Server::Counters::reset() {
+  for (auto *counter : {&frames_received, &frames_rendered, &frames_rejected, &frames_dropped,
+                        &frames_skipped, &bytes_in, &control_requests, &redraws_coalesced,
+                        &frames_synced, &sync_missed, &sync_timeouts, &cache_hits,
+                        &cache_misses, &frame_path_allocations}) {
+    *counter = 0;
+  }
+  display_latency.reset();
+  render_time.reset();
+  sync_skew.reset();
+}
+
+lmz::Server::Server(Canvas &canvas, const ServerOptions &options)
+    : canvas(canvas), options(options), matrix_width(canvas.width()),
+      matrix_height(canvas.height()),
+      frame_size(matrix_width * matrix_height * consts::pixel_size),
+      max_message_size(frame_size * consts::max_frame_message_factor), stopping(false),
+      wake_pending(true),
+      row_buffer(matrix_width), current_frame(frame_size), shm(), showing_shm(false),
+      skip_duplicates(false), frame_slot_hidden(false),
+      canvas_shadows(canvas.buffer_count(),
+                     CanvasShadow{.frame = std::vector<std::byte>(frame_size), .valid = false}),
+      brightness_current(std::clamp(options.brightness, 0, 255)),
+      color_temp_current_k(std::clamp(options.temperature, color_temp::min, color_temp::max)),
+      color_temp_current(color_temp::get(color_temp_current_k)), color_scale(),
+      calibration_current(), calibration_tables(),
+      brightness_fade({.active = false,
+                       .generation = 0,
+                       .from = 0,
+                       .to = 0,
+                       .easing = Easing::Linear,
+                       .start = {},
+                       .duration = {}}),
+      temperature_fade(brightness_fade), next_fade_step(),
+      brightness_request{.value = brightness_current.load(), .generation = 0},
+      temperature_request{.value = color_temp_current_k.load(), .generation = 0},
+      control_generation(0), applied_generation(0), pending_control_updates(0),
+      seen_generation(0),
+      playback({.clip = nullptr,
+                .state = ClipState::Stopped,
+                .loop = true,
+                .rate_percent = 100,
+                .showing = false,
+                .shown = 0,
+                .redraw = false,
+                .next = 0,
+                .next_time = {}}),
+      latest_commit(), pending_commit(),
+      staged({.active = false, .sequence = 0, .received = {}, .staged = {}}), counters(),
+      render_timing({.frames = 0,
+                     .total = {},
+                     .max = {},
+                     .last_report = std::chrono::steady_clock::now(),
+                     .last_present = {},
+                     .intervals = 0,
+                     .interval_mean_us = 0,
+                     .interval_m2 = 0,
+                     .interval_min_us = 0,
+                     .interval_max_us = 0}) {
+  // ZeroMQ starts its I/O threads with the first socket, so this has to come before any.
+  if (!options.zmq_io_cpus.empty()) {
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+    for (const auto cpu : options.zmq_io_cpus) {
+      ctx.set(zmq::ctxopt::thread_affinity_cpu_add, cpu);
+    }
+#else
+    PLOG_WARNING << "This ZeroMQ can't pin its I/O threads, ignoring their CPU list";
+#endif
+  }
+
+  if (!options.shm_name.empty()) {
+    shm = ShmRing::create(options.shm_name, matrix_width, matrix_height);
+  }
+
+  frames.reset(FrameSlot{
+      .data = std::vector<std::byte>(max_message_size), .received = {}, .sequence = {}});
+
+  PLOG_INFO << "Using " << pixel_kernel::name(pixel_kernel::best_path()) << " pixel kernel";
+
+  if (!options.calibration.tiles.empty()) {
+    // Nothing renders yet, so these can go straight in.
+    if (auto tables = compile_calibration(options.calibration)) {
+      calibration_current = options.calibration;
+      calibration_tables = std::move(*tables);
+    }
+  }
+  update_color_scale();
+
+  if (options.test_pattern) {
+    render_test_pattern();
+  }
+}
+
+lmz::Server::~Server() { stop(); }
+
+void lmz::Server::start() {
+  frame_thread = std::thread([this] {
+    thread_tuning::apply(options.frame_thread, "frame");
+    frame_loop();
+  });
+  render_thread = std::thread([this] {
+    thread_tuning::apply(options.render_thread, "render");
+    render_loop();
+  });
+  control_thread = std::thread([this] {
+    thread_tuning::apply(options.control_thread, "control");
+    control_loop();
+  });
+  if (!options.sync_endpoint.empty()) {
+    sync_thread = std::thread([this] {
+      thread_tuning::apply(options.sync_thread, "sync");
+      sync_loop();
+    });
+  }
+  if (shm) {
+    shm_thread = std::thread([this] {
+      thread_tuning::apply(options.frame_thread, "shm");
+      shm_loop();
+    });
+  }
+}
+
+void lmz::Server::wait() {
+  for (auto *thread : {&frame_thread, &render_thread, &control_thread, &sync_thread,
+                       &shm_thread}) {
+    if (thread->joinable()) {
+      thread->join();
+    }
+  }
+}
+
+void lmz::Server::stop() {
+  if (stopping.exchange(true)) {
+    return;
+  }
+
+  // Makes every blocking socket call throw ETERM, which the loops take as their cue to exit.
+  ctx.shutdown();
+  if (shm) {
+    shm->wake();
+  }
+  wake_renderer();
+  wait();
+}
+
+lmz::StatsArgs lmz::Server::stats() const { return counters.snapshot(); }
+
+void lmz::Server::record_render_time(std::chrono::nanoseconds elapsed) {
+  counters.render_time.record(elapsed);
+  counters.frames_rendered++;
+
+  auto &timing = render_timing;
+  timing.frames++;
+  timing.total += elapsed;
+  timing.max = std::max(timing.max, elapsed);
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - timing.last_report < consts::render_report_interval) {
+    return;
+  }
+
+  if (options.measure_jitter) {
+    report_jitter();
+  }
+
+  using us = std::chrono::microseconds;
+  PLOG_DEBUG << "Rendered " << timing.frames << " frames, write time avg "
+             << std::chrono::duration_cast<us>(timing.total / timing.frames).count() << "us, max "
+             << std::chrono::duration_cast<us>(timing.max).count() << "us, "
+             << counters.frames_dropped << " superseded in total";
+  if (alloc_counter::enabled()) {
+    PLOG_DEBUG << counters.frame_path_allocations << " frame path allocations in total";
+  }
+
+  timing.frames = 0;
+  timing.total = {};
+  timing.max = {};
+  timing.last_report = now;
+}
+
+void lmz::Server::record_present_interval(std::chrono::steady_clock::time_point now) {
+  auto &timing = render_timing;
+  const auto previous = std::exchange(timing.last_present, now);
+  if (previous == std::chrono::steady_clock::time_point{}) {
+    return;
+  }
+
+  const auto interval_us = std::chrono::duration<double, std::micro>(now - previous).count();
+  timing.intervals++;
+  const auto delta = interval_us - timing.interval_mean_us;
+  timing.interval_mean_us += delta / timing.intervals;
+  timing.interval_m2 += delta * (interval_us - timing.interval_mean_us);
+
+  if (timing.intervals == 1) {
+    timing.interval_min_us = interval_us;
+    timing.interval_max_us = interval_us;
+  } else {
+    timing.interval_min_us = std::min(timing.interval_min_us, interval_us);
+    timing.interval_max_us = std::max(timing.interval_max_us, interval_us);
+  }
+}
+
+// Only steady input gives meaningful numbers, e.g. led-matrix-zmq-load --fps.
+void lmz::Server::report_jitter() {
+  auto &timing = render_timing;
+  if (timing.intervals < 2) {
+    return;
+  }
+
+  const auto stddev_us = std::sqrt(timing.interval_m2 / (timing.intervals - 1));
+  PLOG_INFO << std::format("Render interval over {} frames: mean {:.0f}us, stddev {:.0f}us, min "
+                           "{:.0f}us, max {:.0f}us",
+                           timing.intervals, timing.interval_mean_us, stddev_us,
+                           timing.interval_min_us, timing.interval_max_us);
+
+  timing.intervals = 0;
+  timing.interval_mean_us = 0;
+  timing.interval_m2 = 0;
+}
+
+void lmz::Server::render_test_pattern() {
+  auto &slot = frames.write_slot();
+  auto *pixels = reinterpret_cast<std::uint32_t *>(slot.data.data());
+  test_pattern::render({pixels, frame_size / consts::pixel_size}, matrix_width, matrix_height);
+
+  std::copy_n(slot.data.begin(), frame_size, current_frame.begin());
+  slot.received = std::chrono::steady_clock::now();
+  slot.sequence.reset();
+  frames.publish();
+}
+
+void lmz::Server::invalidate_canvas_shadows() {
+  for (auto &shadow : canvas_shadows) {
+    shadow.valid = false;
+  }
+}
+
+void lmz::Server::wake_renderer() {
+  {
+    const std::lock_guard<std::mutex> guard(wake_mutex);
+    wake_pending = true;
+  }
+  wake_cv.notify_one();
+}
+
+void lmz::Server::wait_for_render(std::optional<std::chrono::steady_clock::time_point> deadline) {
+  std::unique_lock<std::mutex> lock(wake_mutex);
+  if (deadline) {
+    wake_cv.wait_until(lock, *deadline, [this] { return wake_pending; });
+  } else {
+    wake_cv.wait(lock, [this] { return wake_pending; });
+  }
+  wake_pending = false;
+}
+
+void lmz::Server::update_matrix() {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  const auto start = std::chrono::steady_clock::now();
+
+  const auto frame_buffer = playback.showing ? playback.clip->frame(playback.shown)
+                            : showing_shm    ? shm->read_frame()
+                                             : std::span<const std::byte>(frames.read_slot().data);
+  std::span<const std::uint32_t> data(reinterpret_cast<const std::uint32_t *>(frame_buffer.data()),
+                                      frame_size / sizeof(std::uint32_t));
+
+  auto &shadow = canvas_shadows[canvas.back_buffer()];
+  const auto row_size = matrix_width * consts::pixel_size;
+
+  for (auto y = 0; y < matrix_height; ++y) {
+    const auto *row = frame_buffer.data() + y * row_size;
+    auto *shadow_row = shadow.frame.data() + y * row_size;
+    if (shadow.valid && std::memcmp(row, shadow_row, row_size) == 0) {
+      continue;
+    }
+    std::memcpy(shadow_row, row, row_size);
+
+    if (calibration_tables.empty()) {
+      pixel_kernel::convert(data.data() + y * matrix_width, row_buffer.data(), matrix_width,
+                            color_scale);
+    } else {
+      calibration_tables.convert_row(y, data.data() + y * matrix_width, row_buffer.data(),
+                                     matrix_width, color_scale);
+    }
+    canvas.set_row(y, row_buffer);
+  }
+
+  const auto written = std::chrono::steady_clock::now();
+  shadow.valid = true;
+  record_render_time(written - start);
+
+  // A staged frame stays in the back buffer, redraws included, until its commit presents it.
+  if (!staged.active) {
+    present_canvas();
+  }
+}
+
+// Hands the finished frame over to the display and moves on to the next buffer.
+void lmz::Server::present_canvas() {
+  canvas.present();
+  if (options.measure_jitter) {
+    record_present_interval(std::chrono::steady_clock::now());
+  }
+}
+
+void lmz::Server::update_color_scale() {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  color_scale = pixel_kernel::make_scale(brightness_current, color_temp_current);
+  calibration_tables.rescale(color_scale.tables);
+  invalidate_canvas_shadows();
+}
+
+// Fits the corrections to the canvas, or logs why they don't.
+std::optional<calibration::Compiled>
+lmz::Server::compile_calibration(const calibration::Calibration &calibration) const {
+  try {
+    calibration::Compiled tables(calibration, matrix_width, matrix_height, options.panel_width,
+                                 options.panel_height);
+    PLOG_INFO << "Calibrating " << tables.tile_count() << " tiles of " << tables.tile_width()
+              << "x" << tables.tile_height();
+    return tables;
+  } catch (const std::runtime_error &err) {
+    PLOG_ERROR << "Could not apply calibration: " << err.what();
+    return std::nullopt;
+  }
+}
+
+// Hands new corrections to the renderer, which swaps them in with its next redraw. Keeps the old
+// ones if these don't fit the canvas.
+bool lmz::Server::set_calibration(const calibration::Calibration &calibration) {
+  auto tables = compile_calibration(calibration);
+  if (!tables) {
+    return false;
+  }
+
+  const auto generation = control_generation.load(std::memory_order_relaxed) + 1;
+  {
+    const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+    calibration_request =
+        CalibrationChange{.calibration = calibration, .tables = std::move(*tables)};
+  }
+  announce_change(generation);
+  return true;
+}
+
+// What the corrections are about to be, if the renderer hasn't swapped them in yet.
+lmz::Server::LatestCalibration lmz::Server::latest_calibration() const {
+  if (calibration_request) {
+    return {.calibration = calibration_request->calibration, .tables = calibration_request->tables};
+  }
+  return {.calibration = calibration_current, .tables = calibration_tables};
+}
+
+lmz::CalibrationArgs lmz::Server::calibration_status() {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  const auto &tables = latest_calibration().tables;
+  return CalibrationArgs{
+      .tile_width = static_cast<uint16_t>(tables.tile_width()),
+      .tile_height = static_cast<uint16_t>(tables.tile_height()),
+      .tile_count = static_cast<uint16_t>(tables.tile_count()),
+  };
+}
+
+void lmz::Server::request_change(ControlRequest &request, int value) {
+  // The request is complete before the generation announcing it is published.
+  const auto generation = control_generation.load(std::memory_order_relaxed) + 1;
+  request.value.store(value, std::memory_order_relaxed);
+  request.generation.store(generation, std::memory_order_relaxed);
+  announce_change(generation);
+}
+
+// Publishes a complete request to the renderer, then waits for it to be shown if asked to.
+void lmz::Server::announce_change(std::uint64_t generation) {
+  control_generation.store(generation, std::memory_order_release);
+  pending_control_updates++;
+  wake_renderer();
+
+  if (!options.defer_control_replies) {
+    return;
+  }
+
+  auto applied = applied_generation.load(std::memory_order_acquire);
+  while (applied < generation) {
+    applied_generation.wait(applied, std::memory_order_acquire);
+    applied = applied_generation.load(std::memory_order_acquire);
+  }
+}
+
+// Takes in every control request since the last pass, however many there were. Only the color
+// scale changes, the caller redraws if this returns true.
+bool lmz::Server::apply_control_changes() {
+  const auto generation = control_generation.load(std::memory_order_acquire);
+  if (generation == seen_generation) {
+    return false;
+  }
+
+  auto changed = false;
+  const auto brightness_generation = brightness_request.generation.load(std::memory_order_relaxed);
+  if (brightness_generation > seen_generation) {
+    if (brightness_generation > brightness_fade.generation) {
+      brightness_fade.active = false;
+    }
+
+    const auto brightness = brightness_request.value.load(std::memory_order_relaxed);
+    changed |= brightness != brightness_current;
+    brightness_current = brightness;
+  }
+
+  const auto temperature_generation =
+      temperature_request.generation.load(std::memory_order_relaxed);
+  if (temperature_generation > seen_generation) {
+    if (temperature_generation > temperature_fade.generation) {
+      temperature_fade.active = false;
+    }
+
+    const auto temperature = temperature_request.value.load(std::memory_order_relaxed);
+    if (temperature != color_temp_current_k) {
+      color_temp_current_k = temperature;
+      color_temp_current = color_temp::get(temperature);
+      changed = true;
+    }
+  }
+
+  {
+    // Calibration requests hand over under matrix_mutex rather than through the generation.
+    const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+    if (calibration_request) {
+      calibration_current = std::move(calibration_request->calibration);
+      calibration_tables = std::move(calibration_request->tables);
+      calibration_request.reset();
+      changed = true;
+    }
+  }
+
+  seen_generation = generation;
+
+  const auto updates = pending_control_updates.exchange(0);
+  if (updates > 1) {
+    counters.redraws_coalesced += updates - 1;
+  }
+
+  if (changed) {
+    update_color_scale();
+  }
+
+  return changed;
+}
+
+void lmz::Server::publish_applied_generation(std::uint64_t generation) {
+  if (applied_generation.load(std::memory_order_relaxed) != generation) {
+    applied_generation.store(generation, std::memory_order_release);
+    applied_generation.notify_all();
+  }
+}
+
+void lmz::Server::set_brightness(int brightness) {
+  request_change(brightness_request, std::clamp(brightness, 0, 255));
+}
+
+int lmz::Server::get_brightness() {
+  // A request the renderer hasn't applied yet is what the brightness is about to be.
+  if (brightness_request.generation > applied_generation) {
+    return brightness_request.value;
+  }
+
+  return brightness_current;
+}
+
+void lmz::Server::set_temperature(int temperature) {
+  request_change(temperature_request,
+                 std::clamp(temperature, color_temp::min, color_temp::max));
+}
+
+int lmz::Server::get_temperature() {
+  if (temperature_request.generation > applied_generation) {
+    return temperature_request.value;
+  }
+
+  return color_temp_current_k;
+}
+
+int lmz::Server::Fade::step(std::chrono::steady_clock::time_point now) {
+  const auto t = duration.count() > 0
+                     ? std::chrono::duration<double>(now - start) /
+                           std::chrono::duration<double>(duration)
+                     : 1.0;
+  if (t >= 1.0) {
+    active = false;
+  }
+
+  return from + static_cast<int>(std::lround((to - from) * ::easing::apply(easing, t)));
+}
+
+void lmz::Server::start_fade(Fade &fade, int from, int to, std::uint32_t duration_ms,
+                             Easing easing) {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  const auto now = std::chrono::steady_clock::now();
+  fade = {
+      .active = true,
+      .generation = control_generation.load(std::memory_order_relaxed),
+      .from = from,
+      .to = to,
+      .easing = easing,
+      .start = now,
+      .duration = std::chrono::milliseconds(duration_ms),
+  };
+  next_fade_step = now;
+  wake_renderer();
+}
+
+// Moves any running fades on to `now`. Only the color scale changes, the caller redraws if this
+// returns true.
+bool lmz::Server::step_fades(std::chrono::steady_clock::time_point now) {
+  if ((!brightness_fade.active && !temperature_fade.active) || now < next_fade_step) {
+    return false;
+  }
+  next_fade_step = now + consts::fade_step_interval;
+
+  auto changed = false;
+  if (brightness_fade.active) {
+    const auto brightness = brightness_fade.step(now);
+    changed |= brightness != brightness_current;
+    brightness_current = brightness;
+  }
+
+  if (temperature_fade.active) {
+    const auto temperature = temperature_fade.step(now);
+    if (temperature != color_temp_current_k) {
+      color_temp_current_k = temperature;
+      color_temp_current = color_temp::get(temperature);
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    update_color_scale();
+  }
+
+  return changed;
+}
+
+std::optional<std::chrono::steady_clock::time_point> lmz::Server::render_deadline() const {
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  if (playback.state == ClipState::Playing) {
+    deadline = playback.next_time;
+  }
+
+  if (brightness_fade.active || temperature_fade.active) {
+    deadline = deadline ? std::min(*deadline, next_fade_step) : next_fade_step;
+  }
+
+  if (pending_commit) {
+    const auto expiry = pending_commit->received + options.sync_timeout;
+    deadline = deadline ? std::min(*deadline, expiry) : expiry;
+  }
+
+  if (staged.active) {
+    const auto expiry = staged.staged + options.sync_timeout;
+    deadline = deadline ? std::min(*deadline, expiry) : expiry;
+  }
+
+  return deadline;
+}
+
+// Draws a sequenced frame without presenting it. The renderer takes no newer frame until this one
+// is presented or given up on.
+void lmz::Server::stage_frame(const FrameSlot &slot, std::chrono::steady_clock::time_point now) {
+  staged = {.active = true, .sequence = *slot.sequence, .received = slot.received, .staged = now};
+  update_matrix();
+}
+
+void lmz::Server::present_staged_frame() {
+  staged.active = false;
+  present_canvas();
+  counters.display_latency.record(std::chrono::steady_clock::now() - staged.received);
+}
+
+void lmz::Server::take_sync_commit() {
+  const std::lock_guard<std::mutex> guard(sync_mutex);
+  if (!latest_commit) {
+    return;
+  }
+
+  if (pending_commit) {
+    // Its frame never turned up before the next commit.
+    counters.sync_missed++;
+  }
+  pending_commit = std::exchange(latest_commit, std::nullopt);
+}
+
+// Presents the staged frame if the pending commit is for it. Otherwise drops whichever of the
+// two is older, so the other can be matched up with what comes next.
+void lmz::Server::apply_sync_commit() {
+  if (!pending_commit || !staged.active) {
+    return;
+  }
+
+  const auto commit = *pending_commit;
+  if (staged.sequence == commit.sequence) {
+    pending_commit.reset();
+    present_staged_frame();
+    counters.frames_synced++;
+    counters.sync_skew.record(std::chrono::steady_clock::now() - commit.received);
+  } else if (sequence_after(commit.sequence, staged.sequence)) {
+    // The other servers have moved past the staged frame, whose commit was lost. Leave it in the
+    // back buffer to be drawn over.
+    PLOG_DEBUG << "Dropping frame " << staged.sequence << " for commit " << commit.sequence;
+    staged.active = false;
+    counters.sync_missed++;
+  } else {
+    pending_commit.reset();
+    counters.sync_missed++;
+  }
+}
+
+void lmz::Server::expire_sync(std::chrono::steady_clock::time_point now) {
+  if (pending_commit && now >= pending_commit->received + options.sync_timeout) {
+    PLOG_DEBUG << "Frame " << pending_commit->sequence << " didn't arrive in time for its commit";
+    pending_commit.reset();
+    counters.sync_missed++;
+  }
+
+  // Without commits, e.g. after the proxy went away, show frames late rather than never.
+  if (staged.active && now >= staged.staged + options.sync_timeout) {
+    PLOG_DEBUG << "No commit for frame " << staged.sequence << ", presenting it anyway";
+    present_staged_frame();
+    counters.sync_timeouts++;
+  }
+}
+
+void lmz::Server::show_clip_frame_now(std::uint32_t index) {
+  staged.active = false;
+  playback.showing = true;
+  frame_slot_hidden = true;
+  playback.shown = index;
+  update_matrix();
+}
+
+void lmz::Server::show_clip_frame() {
+  auto &p = playback;
+  show_clip_frame_now(p.next);
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto interval = p.clip->frame_interval() * 100 / p.rate_percent;
+  p.next_time += interval;
+  if (p.next_time < now) {
+    // Fell behind, e.g. after a slow redraw, so carry on from now rather than rushing to catch up.
+    p.next_time = now + interval;
+  }
+
+  if (++p.next == p.clip->frame_count()) {
+    p.next = 0;
+    if (!p.loop) {
+      // Hold the last frame.
+      p.state = ClipState::Paused;
+    }
+  }
+}
+
+lmz::ClipStatusArgs lmz::Server::clip_status() {
+  const auto &p = playback;
+  return ClipStatusArgs{
+      .state = p.state,
+      .frame = p.showing ? p.shown : p.next,
+      .frame_count = p.clip ? p.clip->frame_count() : 0,
+      .frame_interval_us =
+          p.clip ? static_cast<std::uint32_t>(p.clip->frame_interval().count()) : 0,
+      .rate_percent = p.rate_percent,
+      .loop = p.loop,
+  };
+}
+
+void lmz::Server::render_loop() {
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  while (true) {
+    wait_for_render(deadline);
+    if (stopping) {
+      // Don't leave a deferred control reply waiting forever.
+      publish_applied_generation(std::numeric_limits<std::uint64_t>::max());
+      return;
+    }
+
+    const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+    const auto allocations = alloc_counter::thread_count();
+    const auto now = std::chrono::steady_clock::now();
+    const auto controlled = apply_control_changes();
+    const auto faded = step_fades(now);
+    const auto syncing = !options.sync_endpoint.empty();
+    if (syncing) {
+      take_sync_commit();
+      apply_sync_commit();
+    }
+
+    const auto holding = staged.active;
+    const auto live = !holding && frames.consume();
+    const auto shared = !holding && shm && shm->consume();
+    if (live || shared) {
+      // Live frames always win over clip playback.
+      if (playback.showing) {
+        PLOG_INFO << "Live frame received, stopping clip playback";
+        playback.state = ClipState::Stopped;
+        playback.showing = false;
+      }
+
+      // Frames from both at once are unusual, show whichever is newer.
+      const auto &slot = frames.read_slot();
+      showing_shm = shared && (!live || shm->read_published() >= slot.received);
+      if (showing_shm) {
+        // The frame slot no longer matches the canvas, so its next frame must be drawn.
+        frame_slot_hidden = true;
+        counters.frames_received++;
+        counters.bytes_in += frame_size;
+        update_matrix();
+        counters.display_latency.record(std::chrono::steady_clock::now() - shm->read_published());
+      } else if (syncing && slot.sequence) {
+        stage_frame(slot, now);
+        apply_sync_commit(); // Its commit may have come first
+      } else {
+        update_matrix();
+        counters.display_latency.record(std::chrono::steady_clock::now() - slot.received);
+      }
+    } else if (playback.state == ClipState::Playing && now >= playback.next_time) {
+      show_clip_frame();
+    } else if (playback.redraw && playback.showing) {
+      show_clip_frame_now(playback.shown);
+    } else if (playback.redraw || controlled || faded) {
+      update_matrix();
+    }
+    playback.redraw = false;
+
+    if (syncing) {
+      expire_sync(now);
+      if (holding && !staged.active) {
+        // Frames that arrived while this one was staged are still waiting.
+        wake_renderer();
+      }
+    }
+    publish_applied_generation(seen_generation);
+    counters.frame_path_allocations += alloc_counter::thread_count() - allocations;
+
+    deadline = render_deadline();
+  }
+}
+
+void lmz::Server::frame_loop() {
+  const auto &socket_options = options.frame_socket_options;
+  auto sock = frame_socket::make_receiver(ctx, socket_options);
+  sock.bind(options.frame_endpoint);
+
+  PLOG_INFO << "Listening for frames on " << options.frame_endpoint << " ("
+            << frame_socket::name(socket_options.mode) << ")";
+  FrameDecoder decoder(matrix_width, matrix_height, options.frame_cache_bytes);
+
+  PLOG_INFO << "Expected frame size: " << frame_size << " bytes" << " (" << matrix_width << "x"
+            << matrix_height << "x" << consts::bpp << "bpp)";
+  if (options.frame_cache_bytes > 0) {
+    PLOG_INFO << "Caching up to " << options.frame_cache_bytes / frame_size << " frames";
+  }
+
+  try {
+    while (true) {
+      // Receive straight into the free triple buffer slot, so the steady state never allocates.
+      // Oversized messages are truncated by ZMQ and rejected below.
+      auto &slot = frames.write_slot();
+      const auto allocations = alloc_counter::thread_count();
+      const auto res = sock.recv(zmq::mutable_buffer(slot.data.data(), slot.data.size()),
+                                 zmq::recv_flags::none);
+      slot.received = std::chrono::steady_clock::now();
+
+      // A reference to a cached frame is only answered once it's clear whether that was a miss.
+      const auto cached_hash =
+          res && !res->truncated()
+              ? get_cached_frame_hash(std::span<const std::byte>(slot.data.data(), res->size))
+              : std::nullopt;
+      if (!cached_hash) {
+        frame_socket::acknowledge_frame(sock, socket_options);
+      }
+
+      if (!res) {
+        continue;
+      }
+
+      counters.bytes_in += res->untruncated_size;
+      if (res->truncated()) {
+        PLOG_ERROR << "Received frame message larger than " << max_message_size << " bytes";
+        counters.frames_rejected++;
+        continue;
+      }
+
+      // Plain frames are already in place in the slot, anything else is decoded on top of the
+      // current frame and copied back in.
+      const auto message = std::span<const std::byte>(slot.data.data(), res->size);
+      try {
+        const auto result = decoder.decode(message, current_frame);
+        if (const auto hit = decoder.cache_hit()) {
+          (*hit ? counters.cache_hits : counters.cache_misses)++;
+        }
+        if (cached_hash) {
+          frame_socket::acknowledge_cached_frame(sock, socket_options, *cached_hash,
+                                                 decoder.cache_hit().value_or(false));
+        }
+        if (result == FrameDecoder::Result::NoFrame) {
+          continue;
+        }
+
+        // Producers often resend the same frame at a fixed rate. Drawing it again changes nothing.
+        // A repeated sequenced frame still has a commit to wait for, though.
+        slot.sequence = decoder.sequence();
+        const auto staged_frame = slot.sequence && !options.sync_endpoint.empty();
+        if (frame_slot_hidden.exchange(false)) {
+          skip_duplicates = false;
+        }
+        if (result == FrameDecoder::Result::Unchanged && skip_duplicates && !staged_frame) {
+          counters.frames_received++;
+          counters.frames_skipped++;
+          counters.frame_path_allocations += alloc_counter::thread_count() - allocations;
+          continue;
+        }
+
+        if (message.size() != frame_size) {
+          std::copy(current_frame.begin(), current_frame.end(), slot.data.begin());
+        }
+      } catch (const std::runtime_error &err) {
+        PLOG_ERROR << err.what() << " (" << message.size() << " bytes, full frames are "
+                   << frame_size << ")";
+        counters.frames_rejected++;
+        continue;
+      }
+
+      // Never wait on the renderer here, just hand over the newest frame.
+      counters.frames_received++;
+      if (frames.publish()) {
+        counters.frames_dropped++;
+      }
+      skip_duplicates = true;
+      wake_renderer();
+      counters.frame_path_allocations += alloc_counter::thread_count() - allocations;
+    }
+  } catch (const zmq::error_t &err) {
+    if (err.num() != ETERM) {
+      throw;
+    }
+  }
+}
+
+template <lmz::IsMessage RequestT>
+lmz::MessageReplyType<RequestT> lmz::Server::process_request(const RequestT &) {
+  static_assert(false, "No process implementation for this message");
+}
+
+template <>
+lmz::GetBrightnessReply lmz::Server::process_request(const lmz::GetBrightnessRequest &) {
+  return GetBrightnessReply{
+      .args = {.brightness = static_cast<uint8_t>(get_brightness())},
+  };
+}
+
+template <> lmz::NullReply lmz::Server::process_request(const lmz::SetBrightnessRequest &req_msg) {
+  PLOG_INFO << "Setting brightness to " << std::to_string(req_msg.args.brightness) << "";
+
+  set_brightness(req_msg.args.brightness);
+
+  return NullReply{};
+}
+
+template <>
+lmz::GetTemperatureReply lmz::Server::process_request(const lmz::GetTemperatureRequest &) {
+  return GetTemperatureReply{
+      .args = {.temperature = static_cast<uint16_t>(get_temperature())},
+  };
+}
+
+template <>
+lmz::NullReply lmz::Server::process_request(const lmz::SetTemperatureRequest &req_msg) {
+  if (req_msg.args.temperature < color_temp::min || req_msg.args.temperature > color_temp::max) {
+    PLOG_ERROR << "Received invalid temperature: " << req_msg.args.temperature << "K";
+    return NullReply{};
+  }
+  PLOG_INFO << "Setting temperature to " << std::to_string(req_msg.args.temperature) << "K";
+
+  set_temperature(req_msg.args.temperature);
+
+  return NullReply{};
+}
+
+template <>
+lmz::NullReply lmz::Server::process_request(const lmz::FadeBrightnessRequest &req_msg) {
+  PLOG_INFO << "Fading brightness to " << std::to_string(req_msg.args.brightness) << " over "
+            << req_msg.args.duration_ms << "ms";
+
+  start_fade(brightness_fade, get_brightness(), req_msg.args.brightness,
+             req_msg.args.duration_ms, req_msg.args.easing);
+
+  return NullReply{};
+}
+
+template <>
+lmz::NullReply lmz::Server::process_request(const lmz::FadeTemperatureRequest &req_msg) {
+  if (req_msg.args.temperature < color_temp::min || req_msg.args.temperature > color_temp::max) {
+    PLOG_ERROR << "Received invalid temperature: " << req_msg.args.temperature << "K";
+    return NullReply{};
+  }
+  PLOG_INFO << "Fading temperature to " << req_msg.args.temperature << "K over "
+            << req_msg.args.duration_ms << "ms";
+
+  start_fade(temperature_fade, get_temperature(), req_msg.args.temperature,
+             req_msg.args.duration_ms, req_msg.args.easing);
+
+  return NullReply{};
+}
+
+template <> lmz::GetStatsReply lmz::Server::process_request(const lmz::GetStatsRequest &req_msg) {
+  const auto reply = GetStatsReply{.args = counters.snapshot()};
+  if (req_msg.args.reset) {
+    PLOG_INFO << "Resetting stats";
+    counters.reset();
+  }
+
+  return reply;
+}
+
+template <>
+lmz::GetConfigurationReply lmz::Server::process_request(const lmz::GetConfigurationRequest &) {
+  return GetConfigurationReply{
+      .args = {.width = static_cast<uint16_t>(matrix_width),
+               .height = static_cast<uint16_t>(matrix_height)},
+  };
+}
+
+template <> lmz::ClipStatusReply lmz::Server::process_request(const lmz::LoadClipRequest &req_msg) {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  const auto path = std::string(req_msg.args.path, strnlen(req_msg.args.path, clip_path_max));
+
+  try {
+    auto clip = std::make_unique<clip::Clip>(path);
+    if (clip->width() != matrix_width || clip->height() != matrix_height) {
+      throw std::runtime_error("Clip is " + std::to_string(clip->width()) + "x" +
+                               std::to_string(clip->height()) + ", not " +
+                               std::to_string(matrix_width) + "x" + std::to_string(matrix_height));
+    }
+
+    PLOG_INFO << "Playing clip " << path << " (" << clip->frame_count() << " frames)";
+    playback.clip = std::move(clip);
+    playback.state = ClipState::Playing;
+    playback.loop = req_msg.args.loop;
+    playback.rate_percent = 100;
+    playback.showing = false;
+    playback.next = 0;
+    playback.next_time = std::chrono::steady_clock::now();
+    wake_renderer();
+  } catch (const std::runtime_error &err) {
+    PLOG_ERROR << "Could not load clip: " << err.what();
+  }
+
+  return ClipStatusReply{.args = clip_status()};
+}
+
+template <>
+lmz::ClipStatusReply lmz::Server::process_request(const lmz::ClipControlRequest &req_msg) {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  const auto value = req_msg.args.value;
+  auto &p = playback;
+
+  if (!p.clip) {
+    PLOG_ERROR << "Received clip control message with no clip loaded";
+    return ClipStatusReply{.args = clip_status()};
+  }
+
+  switch (req_msg.args.action) {
+  case ClipAction::Play: {
+    p.state = ClipState::Playing;
+    p.next_time = std::chrono::steady_clock::now();
+    wake_renderer();
+  } break;
+  case ClipAction::Pause: {
+    if (p.state == ClipState::Playing) {
+      p.state = ClipState::Paused;
+    }
+  } break;
+  case ClipAction::Stop: {
+    p.state = ClipState::Stopped;
+    p.showing = false;
+    p.redraw = true;
+    p.next = 0;
+    wake_renderer();
+  } break;
+  case ClipAction::Seek: {
+    const auto frame = std::min(value, p.clip->frame_count() - 1);
+    if (p.state == ClipState::Playing) {
+      p.next = frame;
+    } else {
+      // Show it straight away, playing on from there if asked to.
+      p.state = ClipState::Paused;
+      p.showing = true;
+      p.shown = frame;
+      p.redraw = true;
+      p.next = (frame + 1) % p.clip->frame_count();
+      wake_renderer();
+    }
+  } break;
+  case ClipAction::SetRate: {
+    p.rate_percent = std::clamp<std::uint32_t>(value, 1, UINT16_MAX);
+  } break;
+  case ClipAction::SetLoop: {
+    p.loop = value != 0;
+  } break;
+  default: {
+    PLOG_ERROR << "Received clip control message with invalid action";
+  } break;
+  }
+
+  return ClipStatusReply{.args = clip_status()};
+}
+
+template <> lmz::ClipStatusReply lmz::Server::process_request(const lmz::GetClipStatusRequest &) {
+  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+  return ClipStatusReply{.args = clip_status()};
+}
+
+template <>
+lmz::CalibrationReply lmz::Server::process_request(const lmz::LoadCalibrationRequest &req_msg) {
+  const auto path =
+      std::string(req_msg.args.path, strnlen(req_msg.args.path, calibration_path_max));
+
+  if (path.empty()) {
+    PLOG_INFO << "Clearing calibration";
+    set_calibration(calibration::Calibration{});
+  } else {
+    try {
+      PLOG_INFO << "Loading calibration " << path;
+      set_calibration(calibration::load(path));
+    } catch (const std::runtime_error &err) {
+      PLOG_ERROR << "Could not load calibration: " << err.what();
+    }
+  }
+
+  return CalibrationReply{.args = calibration_status()};
+}
+
+template <>
+lmz::CalibrationReply lmz::Server::process_request(const lmz::SetTileCalibrationRequest &req_msg) {
+  const auto &args = req_msg.args;
+  PLOG_INFO << "Calibrating tile " << args.x << "," << args.y;
+
+  calibration::Calibration calibration;
+  {
+    // Released before set_calibration(), which may wait for the renderer.
+    const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
+    calibration = latest_calibration().calibration;
+    if (latest_calibration().tables.empty()) {
+      // Stick to the tile size in use rather than whatever an earlier, cleared file said.
+      calibration.tile_width = 0;
+      calibration.tile_height = 0;
+    }
+  }
+
+  auto &correction = calibration.tiles[{args.x, args.y}];
+  for (auto c = 0; c < 3; ++c) {
+    correction.gain[c] = static_cast<float>(args.gain[c]) / calibration_unit;
+    correction.gamma[c] = static_cast<float>(args.gamma[c]) / calibration_unit;
+  }
+  set_calibration(calibration);
+
+  return CalibrationReply{.args = calibration_status()};
+}
+
+template <> lmz::CalibrationReply lmz::Server::process_request(const lmz::GetCalibrationRequest &) {
+  return CalibrationReply{.args = calibration_status()};
+}
+
+template <lmz::IsMessage RequestT>
+void lmz::Server::process_message(zmq::socket_t &sock, const std::span<const std::byte> &data) {
+  const auto req_msg = get_message_from_data<RequestT>(data);
+  const auto reply = process_request<RequestT>(req_msg);
+  sock.send(zmq::const_buffer(&reply, sizeof(reply)), zmq::send_flags::none);
+}
+
+void lmz::Server::control_loop() {
+  zmq::socket_t sock(ctx, zmq::socket_type::rep);
+  sock.bind(options.control_endpoint);
+
+  PLOG_INFO << "Listening for control messages on " << options.control_endpoint;
+
+  try {
+    while (true) {
+      zmq::message_t req;
+      static_cast<void>(sock.recv(req, zmq::recv_flags::none));
+
+      counters.control_requests++;
+
+      const auto data = std::span<const std::byte>(req.data<const std::byte>(), req.size());
+      const auto id = get_id_from_data(data);
+
+      switch (id) {
+      case MessageId::GetBrightnessRequest: {
+        process_message<GetBrightnessRequest>(sock, data);
+      } break;
+      case MessageId::SetBrightnessRequest: {
+        process_message<SetBrightnessRequest>(sock, data);
+      } break;
+      case MessageId::GetTemperatureRequest: {
+        process_message<GetTemperatureRequest>(sock, data);
+      } break;
+      case MessageId::SetTemperatureRequest: {
+        process_message<SetTemperatureRequest>(sock, data);
+      } break;
+      case MessageId::GetConfigurationRequest: {
+        process_message<GetConfigurationRequest>(sock, data);
+      } break;
+      case MessageId::GetStatsRequest: {
+        process_message<GetStatsRequest>(sock, data);
+      } break;
+      case MessageId::LoadClipRequest: {
+        process_message<LoadClipRequest>(sock, data);
+      } break;
+      case MessageId::ClipControlRequest: {
+        process_message<ClipControlRequest>(sock, data);
+      } break;
+      case MessageId::GetClipStatusRequest: {
+        process_message<GetClipStatusRequest>(sock, data);
+      } break;
+      case MessageId::FadeBrightnessRequest: {
+        process_message<FadeBrightnessRequest>(sock, data);
+      } break;
+      case MessageId::FadeTemperatureRequest: {
+        process_message<FadeTemperatureRequest>(sock, data);
+      } break;
+      case MessageId::LoadCalibrationRequest: {
+        process_message<LoadCalibrationRequest>(sock, data);
+      } break;
+      case MessageId::SetTileCalibrationRequest: {
+        process_message<SetTileCalibrationRequest>(sock, data);
+      } break;
+      case MessageId::GetCalibrationRequest: {
+        process_message<GetCalibrationRequest>(sock, data);
+      } break;
+      default: {
+        PLOG_ERROR << "Received control message with invalid type";
+      } break;
+      }
+    }
+  } catch (const zmq::error_t &err) {
+    if (err.num() != ETERM) {
+      throw;
+    }
+  }
+}
+
+void lmz::Server::sync_loop() {
+  zmq::socket_t sock(ctx, zmq::socket_type::sub);
+  sock.set(zmq::sockopt::subscribe, "");
+  sock.connect(options.sync_endpoint);
+
+  PLOG_INFO << "Presenting sequenced frames on commits from " << options.sync_endpoint;
+
+  try {
+    while (true) {
+      SyncCommit commit;
+      const auto res = sock.recv(zmq::mutable_buffer(&commit, sizeof(commit)));
+      const auto received = std::chrono::steady_clock::now();
+      if (!res) {
+        continue;
+      }
+
+      if (res->untruncated_size != sizeof(commit) || commit.magic != sync_magic) {
+        PLOG_ERROR << "Received invalid sync commit (" << res->untruncated_size << " bytes)";
+        continue;
+      }
+
+      {
+        const std::lock_guard<std::mutex> guard(sync_mutex);
+        if (latest_commit) {
+          // The renderer never got to the one before.
+          counters.sync_missed++;
+        }
+        latest_commit = PendingCommit{.sequence = commit.sequence, .received = received};
+      }
+      wake_renderer();
+    }
+  } catch (const zmq::error_t &err) {
+    if (err.num() != ETERM) {
+      throw;
+    }
+  }
+}
+
+void lmz::Server::shm_loop() {
+  PLOG_INFO << "Receiving frames in shared memory " << options.shm_name;
+
+  // Only relays the doorbell, the renderer takes the frame from the ring itself.
+  auto seen = shm->published();
+  while (!stopping) {
+    shm->wait(seen, consts::shm_wait_timeout);
+    if (const auto published = shm->published(); published != seen) {
+      seen = published;
+      wake_renderer();
+    }
+  }
+}
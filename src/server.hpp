@@ -0,0 +1,347 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "calibration.hpp"
+#include "canvas.hpp"
+#include "clip.hpp"
+#include "color_temp.hpp"
+#include "consts.hpp"
+#include "frame_socket.hpp"
+#include "messages.hpp"
+#include "pixel_kernel.hpp"
+#include "shm_ring.hpp"
+#include "stats.hpp"
+#include "thread_tuning.hpp"
+#include "triple_buffer.hpp"
+
+namespace lmz {
+
+struct ServerOptions {
+  std::string frame_endpoint = consts::default_frame_endpoint;
+  std::string control_endpoint = consts::default_control_endpoint;
+
+  // Shared memory frame ring to create for producers on the same host, empty for none.
+  std::string shm_name;
+  frame_socket::Options frame_socket_options = {
+      .mode = frame_socket::Mode::ReqRep,
+      .drop_policy = frame_socket::DropPolicy::Block,
+      .hwm = 1000,
+  };
+
+  // Bytes of recently shown frames to keep for Cached frame messages, 0 for no cache.
+  std::size_t frame_cache_bytes = 0;
+
+  int brightness = 255;
+  int temperature = color_temp::max;
+  bool test_pattern = true;
+
+  // Only reply to set requests once the change is on the canvas.
+  bool defer_control_replies = false;
+
+  // Per-panel corrections to start with, and the panel size their tiles default to (0 for the
+  // whole canvas).
+  calibration::Calibration calibration;
+  int panel_width = 0;
+  int panel_height = 0;
+
+  // Affinity and scheduling for each server thread, and the cores ZeroMQ's I/O threads may use.
+  thread_tuning::Settings frame_thread;
+  thread_tuning::Settings render_thread;
+  thread_tuning::Settings control_thread;
+  std::vector<int> zmq_io_cpus;
+
+  // Periodically log how evenly spaced presented frames are.
+  bool measure_jitter = false;
+
+  // Where to subscribe to sync commits, empty for none. With one, sequenced frames are held back
+  // until their commit arrives, or until sync_timeout passes.
+  std::string sync_endpoint;
+  std::chrono::milliseconds sync_timeout{100};
+  thread_tuning::Settings sync_thread;
+};
+
+// Receives frames and control messages and draws onto a canvas, independent of what the canvas
+// actually is. Runs a receiver, a renderer and a control thread between start() and stop(), plus
+// a sync thread if there is a sync endpoint and a doorbell thread if there is a shared memory ring.
+class Server {
+public:
+  // Throws std::runtime_error if the shared memory ring can't be created.
+  Server(Canvas &canvas, const ServerOptions &options);
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  void start();
+
+  // Blocks until the server threads exit, which they only do once stop() is called.
+  void wait();
+
+  // Closes the sockets and joins the server threads.
+  void stop();
+
+  StatsArgs stats() const;
+
+private:
+  struct FrameSlot {
+    std::vector<std::byte> data;
+    std::chrono::steady_clock::time_point received;
+    std::optional<std::uint32_t> sequence;
+  };
+
+  // What a canvas buffer was last drawn with, so only rows that differ get redrawn.
+  struct CanvasShadow {
+    std::vector<std::byte> frame;
+    bool valid;
+  };
+
+  struct Counters {
+    std::atomic<std::uint64_t> frames_received;
+    std::atomic<std::uint64_t> frames_rendered;
+    std::atomic<std::uint64_t> frames_rejected;
+    std::atomic<std::uint64_t> frames_dropped;
+    std::atomic<std::uint64_t> frames_skipped;
+    std::atomic<std::uint64_t> bytes_in;
+    std::atomic<std::uint64_t> control_requests;
+    std::atomic<std::uint64_t> redraws_coalesced;
+    std::atomic<std::uint64_t> frames_synced;
+    std::atomic<std::uint64_t> sync_missed;
+    std::atomic<std::uint64_t> sync_timeouts;
+    std::atomic<std::uint64_t> cache_hits;
+    std::atomic<std::uint64_t> cache_misses;
+    std::atomic<std::uint64_t> frame_path_allocations;
+
+    stats::Histogram display_latency;
+    stats::Histogram render_time;
+    stats::Histogram sync_skew;
+
+    StatsArgs snapshot() const;
+    void reset();
+  };
+
+  // A clip being played from a file on the server. Guarded by matrix_mutex.
+  struct Playback {
+    std::unique_ptr<clip::Clip> clip;
+    ClipState state;
+    bool loop;
+    std::uint16_t rate_percent;
+
+    // Whether the canvas shows clip frame `shown` rather than the latest live frame.
+    bool showing;
+    std::uint32_t shown;
+    bool redraw; // A stop or seek the renderer hasn't drawn yet
+
+    std::uint32_t next;
+    std::chrono::steady_clock::time_point next_time;
+  };
+
+  // A value set by control requests. The renderer picks it up if `generation` is newer than the
+  // last one it has seen.
+  struct ControlRequest {
+    std::atomic<int> value;
+    std::atomic<std::uint64_t> generation;
+  };
+
+  // Corrections compiled by a control request, waiting for the renderer to swap them in.
+  struct CalibrationChange {
+    calibration::Calibration calibration;
+    calibration::Compiled tables;
+  };
+
+  struct LatestCalibration {
+    const calibration::Calibration &calibration;
+    const calibration::Compiled &tables;
+  };
+
+  // A brightness or temperature fade stepped by the render loop. Guarded by matrix_mutex.
+  struct Fade {
+    bool active;
+    std::uint64_t generation; // Set requests newer than this cancel the fade
+    int from;
+    int to;
+    Easing easing;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+
+    // The value at `now`. Finishes the fade once its time is up.
+    int step(std::chrono::steady_clock::time_point now);
+  };
+
+  // A sequenced frame drawn to the back buffer and waiting for its commit. Guarded by
+  // matrix_mutex.
+  struct StagedFrame {
+    bool active;
+    std::uint32_t sequence;
+    std::chrono::steady_clock::time_point received;
+    std::chrono::steady_clock::time_point staged;
+  };
+
+  struct PendingCommit {
+    std::uint32_t sequence;
+    std::chrono::steady_clock::time_point received;
+  };
+
+  struct RenderTiming {
+    int frames;
+    std::chrono::nanoseconds total;
+    std::chrono::nanoseconds max;
+    std::chrono::steady_clock::time_point last_report;
+
+    // Present-to-present intervals, only with measure_jitter. Mean and variance are kept with
+    // Welford's method.
+    std::chrono::steady_clock::time_point last_present;
+    std::uint64_t intervals;
+    double interval_mean_us;
+    double interval_m2;
+    double interval_min_us;
+    double interval_max_us;
+  };
+
+  void frame_loop();
+  void render_loop();
+  void control_loop();
+  void sync_loop();
+  void shm_loop();
+
+  // Wakes the render loop, which otherwise sleeps until `deadline` or forever.
+  void wake_renderer();
+  void wait_for_render(std::optional<std::chrono::steady_clock::time_point> deadline);
+
+  void render_test_pattern();
+  void record_render_time(std::chrono::nanoseconds elapsed);
+  void record_present_interval(std::chrono::steady_clock::time_point now);
+  void report_jitter();
+  void invalidate_canvas_shadows();
+  void update_matrix();
+  void present_canvas();
+  void update_color_scale();
+
+  void request_change(ControlRequest &request, int value);
+  void announce_change(std::uint64_t generation);
+  bool apply_control_changes();
+  void publish_applied_generation(std::uint64_t generation);
+
+  void start_fade(Fade &fade, int from, int to, std::uint32_t duration_ms, Easing easing);
+  bool step_fades(std::chrono::steady_clock::time_point now);
+  std::optional<std::chrono::steady_clock::time_point> render_deadline() const;
+
+  void stage_frame(const FrameSlot &slot, std::chrono::steady_clock::time_point now);
+  void present_staged_frame();
+  void take_sync_commit();
+  void apply_sync_commit();
+  void expire_sync(std::chrono::steady_clock::time_point now);
+
+  void show_clip_frame();
+  void show_clip_frame_now(std::uint32_t index);
+  ClipStatusArgs clip_status();
+
+  std::optional<calibration::Compiled>
+  compile_calibration(const calibration::Calibration &calibration) const;
+  bool set_calibration(const calibration::Calibration &calibration);
+  LatestCalibration latest_calibration() const;
+  CalibrationArgs calibration_status();
+
+  void set_brightness(int brightness);
+  int get_brightness();
+  void set_temperature(int temperature);
+  int get_temperature();
+
+  template <IsMessage RequestT> MessageReplyType<RequestT> process_request(const RequestT &req);
+  template <IsMessage RequestT>
+  void process_message(zmq::socket_t &sock, const std::span<const std::byte> &data);
+
+  Canvas &canvas;
+  ServerOptions options;
+
+  int matrix_width;
+  int matrix_height;
+  std::size_t frame_size;
+  std::size_t max_message_size;
+
+  zmq::context_t ctx;
+  std::atomic<bool> stopping;
+  std::mutex wake_mutex;
+  std::condition_variable wake_cv;
+  bool wake_pending;
+  std::thread frame_thread;
+  std::thread render_thread;
+  std::thread control_thread;
+  std::thread sync_thread;
+  std::thread shm_thread;
+
+  std::recursive_mutex matrix_mutex;
+
+  TripleBuffer<FrameSlot> frames;
+  std::vector<std::uint32_t> row_buffer;
+
+  // The latest complete frame, owned by the receiver. Frame messages are decoded into this.
+  std::vector<std::byte> current_frame;
+
+  // Frames written straight into shared memory, and whether the canvas shows the ring's read frame
+  // rather than the frame slot. The renderer draws from the ring without copying.
+  std::optional<ShmRing> shm;
+  bool showing_shm;
+
+  // Whether a frame identical to current_frame can be skipped. False until the first frame and
+  // while a clip is showing, so a repeated live frame still replaces the test pattern or clip.
+  // Only the frame thread touches it. The renderer sets frame_slot_hidden instead when the canvas
+  // stops showing the frame slot, and the frame thread takes that in before its next check.
+  bool skip_duplicates;
+  std::atomic<bool> frame_slot_hidden;
+
+  // One per canvas buffer.
+  std::vector<CanvasShadow> canvas_shadows;
+
+  // What the canvas is drawn with, written by the renderer.
+  std::atomic<int> brightness_current;
+  std::atomic<int> color_temp_current_k;
+  color_temp::TemperatureColor color_temp_current;
+  pixel_kernel::Scale color_scale;
+
+  // Guarded by matrix_mutex. The tables are refolded with color_scale whenever it changes.
+  calibration::Calibration calibration_current;
+  calibration::Compiled calibration_tables;
+
+  Fade brightness_fade;
+  Fade temperature_fade;
+  std::chrono::steady_clock::time_point next_fade_step;
+
+  // Control requests only record what they want and wake the renderer, which applies everything
+  // that arrived since its last pass with a single redraw. Only the control thread bumps
+  // control_generation, and only the renderer reads seen_generation.
+  ControlRequest brightness_request;
+  ControlRequest temperature_request;
+  std::optional<CalibrationChange> calibration_request; // Guarded by matrix_mutex
+  std::atomic<std::uint64_t> control_generation;
+  std::atomic<std::uint64_t> applied_generation;
+  std::atomic<std::uint64_t> pending_control_updates;
+  std::uint64_t seen_generation;
+
+  Playback playback;
+
+  // Sync commits are handed from the sync thread to the renderer through latest_commit. The
+  // renderer holds on to one in pending_commit until its frame turns up or it times out.
+  std::mutex sync_mutex;
+  std::optional<PendingCommit> latest_commit;
+  std::optional<PendingCommit> pending_commit;
+  StagedFrame staged;
+
+  Counters counters;
+  RenderTiming render_timing;
+};
+
+} // namespace lmz
@@ -1,6 +1,8 @@
-#include <cstdint>
-#include <mutex>
-#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
 
 #include <argparse/argparse.hpp>
 #include <led-matrix.h>
@@ -8,219 +10,17 @@
 #include <plog/Formatters/TxtFormatter.h>
 #include <plog/Init.h>
 #include <plog/Log.h>
-#include <zmq.hpp>
 
+#include "calibration.hpp"
 #include "color_temp.hpp"
 #include "consts.hpp"
-#include "messages.hpp"
+#include "frame_socket.hpp"
+#include "rgb_matrix_canvas.hpp"
+#include "server.hpp"
+#include "thread_tuning.hpp"
 
-namespace frame_task {
-
-static std::string frame_endpoint;
-
-static std::recursive_mutex matrix_mutex;
-
-static rgb_matrix::RGBMatrix *matrix;
-static int matrix_width;
-static int matrix_height;
-
-static std::vector<std::byte> frame_buffer(0);
-
-static int brightness_current;
-
-static int color_temp_current_k;
-static std::tuple<int, int, int> color_temp_current;
-
-static void render_test_pattern() {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-
-  std::vector<std::uint32_t> pixels(matrix_width * matrix_height);
-  for (auto y = 0; y < matrix_height; ++y) {
-    for (auto x = 0; x < matrix_width; ++x) {
-      auto b = (y * 255) / matrix_height;
-      auto g = (x * 255) / matrix_width;
-      auto r = 255 - b;
-
-      pixels[y * matrix_width + x] = (r << 0) | (g << 8) | (b << 16);
-    }
-  }
-
-  std::span<const std::byte> data(reinterpret_cast<const std::byte *>(pixels.data()),
-                                  pixels.size() * sizeof(std::uint32_t));
-  frame_buffer.assign(data.begin(), data.end());
-}
-
-static void update_matrix() {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-
-  std::span<const std::uint32_t> data(reinterpret_cast<const std::uint32_t *>(frame_buffer.data()),
-                                      frame_buffer.size() / sizeof(std::uint32_t));
-
-  for (auto y = 0; y < matrix_height; ++y) {
-    for (auto x = 0; x < matrix_width; ++x) {
-      const auto pixel = data[y * matrix_width + x];
-      auto r = (pixel >> 0) & 0xFF;
-      auto g = (pixel >> 8) & 0xFF;
-      auto b = (pixel >> 16) & 0xFF;
-
-      r = (r * brightness_current) / 255;
-      g = (g * brightness_current) / 255;
-      b = (b * brightness_current) / 255;
-
-      r = (r * std::get<0>(color_temp_current)) / 255;
-      g = (g * std::get<1>(color_temp_current)) / 255;
-      b = (b * std::get<2>(color_temp_current)) / 255;
-
-      matrix->SetPixel(x, y, r, g, b);
-    }
-  }
-}
-
-static void set_brightness(int brightness) {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-  brightness_current = std::clamp(brightness, 0, 255);
-  update_matrix();
-}
-
-static int get_brightness() {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-  return brightness_current;
-}
-
-static void set_temperature(int temperature) {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-  color_temp_current_k = std::clamp(temperature, color_temp::min, color_temp::max);
-  color_temp_current = color_temp::get(temperature);
-  update_matrix();
-}
-
-static int get_temperature() {
-  const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-  return color_temp_current_k;
-}
-
-static void loop() {
-  zmq::context_t ctx;
-  zmq::socket_t sock(ctx, zmq::socket_type::rep);
-  sock.bind(frame_endpoint);
-
-  PLOG_INFO << "Listening for frames on " << frame_endpoint;
-  PLOG_INFO << "Expected frame size: " << frame_buffer.size() << " bytes" << " (" << matrix_width
-            << "x" << matrix_height << "x" << consts::bpp << "bpp)";
-
-  while (true) {
-    zmq::message_t req;
-    static_cast<void>(sock.recv(req, zmq::recv_flags::none));
-    sock.send(zmq::message_t(), zmq::send_flags::none);
-
-    if (req.size() != frame_buffer.size()) {
-      PLOG_ERROR << "Received frame of unexpected size: " << req.size() << ", expected "
-                 << frame_buffer.size();
-      continue;
-    }
-
-    const std::lock_guard<std::recursive_mutex> guard(matrix_mutex);
-    auto data = req.data<const std::byte>();
-    frame_buffer.assign(data, data + req.size());
-    update_matrix();
-  }
-}
-
-} // namespace frame_task
-
-namespace control_task {
-
-static std::string control_endpoint;
-
-zmq::context_t ctx;
-zmq::socket_t sock(ctx, zmq::socket_type::rep);
-
-template <lmz::IsMessage RequestT>
-static lmz::MessageReplyType<RequestT> process_request(const RequestT &) {
-  static_assert(false, "No process implementation for this message");
-}
-
-template <> lmz::GetBrightnessReply process_request(const lmz::GetBrightnessRequest &) {
-  return lmz::GetBrightnessReply{
-      .args = {.brightness = static_cast<uint8_t>(frame_task::get_brightness())},
-  };
-}
-
-template <> lmz::NullReply process_request(const lmz::SetBrightnessRequest &req_msg) {
-  PLOG_INFO << "Setting brightness to " << std::to_string(req_msg.args.brightness) << "";
-
-  frame_task::set_brightness(req_msg.args.brightness);
-
-  return lmz::NullReply{};
-}
-
-template <> lmz::GetTemperatureReply process_request(const lmz::GetTemperatureRequest &) {
-  return lmz::GetTemperatureReply{
-      .args = {.temperature = static_cast<uint16_t>(frame_task::get_temperature())},
-  };
-}
-
-template <> lmz::NullReply process_request(const lmz::SetTemperatureRequest &req_msg) {
-  if (req_msg.args.temperature < color_temp::min || req_msg.args.temperature > color_temp::max) {
-    PLOG_ERROR << "Received invalid temperature: " << req_msg.args.temperature << "K";
-    return lmz::NullReply{};
-  }
-  PLOG_INFO << "Setting temperature to " << std::to_string(req_msg.args.temperature) << "K";
-
-  frame_task::set_temperature(req_msg.args.temperature);
-
-  return lmz::NullReply{};
-}
-
-template <> lmz::GetConfigurationReply process_request(const lmz::GetConfigurationRequest &) {
-  return lmz::GetConfigurationReply{
-      .args = {.width = static_cast<uint16_t>(frame_task::matrix_width),
-               .height = static_cast<uint16_t>(frame_task::matrix_height)},
-  };
-}
-
-template <lmz::IsMessage RequestT> void process_message(const std::span<const std::byte> &data) {
-  const auto req_msg = lmz::get_message_from_data<RequestT>(data);
-  const auto reply = process_request<RequestT>(req_msg);
-  sock.send(zmq::const_buffer(&reply, sizeof(reply)), zmq::send_flags::none);
-}
-
-static void loop() {
-  sock.bind(control_endpoint);
-
-  PLOG_INFO << "Listening for control messages on " << control_endpoint;
-
-  while (true) {
-    zmq::message_t req;
-    static_cast<void>(sock.recv(req, zmq::recv_flags::none));
-
-    const auto data = std::span<const std::byte>(req.data<const std::byte>(), req.size());
-    const auto id = lmz::get_id_from_data(data);
-
-    switch (id) {
-    case lmz::MessageId::GetBrightnessRequest: {
-      process_message<lmz::GetBrightnessRequest>(data);
-    } break;
-    case lmz::MessageId::SetBrightnessRequest: {
-      process_message<lmz::SetBrightnessRequest>(data);
-    } break;
-    case lmz::MessageId::GetTemperatureRequest: {
-      process_message<lmz::GetTemperatureRequest>(data);
-    } break;
-    case lmz::MessageId::SetTemperatureRequest: {
-      process_message<lmz::SetTemperatureRequest>(data);
-    } break;
-    case lmz::MessageId::GetConfigurationRequest: {
-      process_message<lmz::GetConfigurationRequest>(data);
-    } break;
-    default: {
-      PLOG_ERROR << "Received control message with invalid type";
-    } break;
-    }
-  }
-}
-
-} // namespace control_task
+static std::unique_ptr<lmz::RgbMatrixCanvas> canvas;
+static lmz::ServerOptions server_options;
 
 static void setup(int argc, char *argv[]) {
   static plog::ColorConsoleAppender<plog::TxtFormatter> consoleAppender;
@@ -246,6 +46,23 @@ static void setup(int argc, char *argv[]) {
 
   parser.add_argument("--frame-endpoint").default_value(consts::default_frame_endpoint);
   parser.add_argument("--control-endpoint").default_value(consts::default_control_endpoint);
+  frame_socket::add_arguments(parser);
+  parser.add_argument("--shm")
+      .help("Also take frames from producers on this host through a shared memory ring")
+      .default_value(false)
+      .implicit_value(true);
+  parser.add_argument("--shm-name").default_value(std::string(consts::default_shm_name));
+  parser.add_argument("--frame-cache-mb")
+      .help("Memory for recently shown frames that producers can show again by hash, 0 to disable")
+      .default_value(16)
+      .scan<'i', int>();
+  parser.add_argument("--sync-endpoint")
+      .help("Hold sequenced frames until a commit for them is published here, e.g. by "
+            "led-matrix-zmq-proxy");
+  parser.add_argument("--sync-timeout-ms")
+      .help("Present a held frame without its commit, or give up on a commit, after this long")
+      .default_value(100)
+      .scan<'i', int>();
 
   parser.add_argument("--brightness")
       .help("Initial brightness (0-255)")
@@ -256,7 +73,22 @@ static void setup(int argc, char *argv[]) {
       .default_value(color_temp::max)
       .scan<'i', int>();
 
+  parser.add_argument("--calibration").help("Per-panel gain and gamma file to start with");
+
+  for (const auto *thread : {"frame", "render", "control", "sync"}) {
+    thread_tuning::add_arguments(parser, thread);
+  }
+  parser.add_argument("--zmq-io-cpus").help("CPUs ZeroMQ's I/O threads may run on, e.g. 0-2");
+  parser.add_argument("--measure-jitter")
+      .help("Periodically log the spread of intervals between presented frames")
+      .default_value(false)
+      .implicit_value(true);
+
   parser.add_argument("--no-test-pattern").default_value(false).implicit_value(true);
+  parser.add_argument("--defer-control-replies")
+      .help("Reply to set requests only once the change is displayed")
+      .default_value(false)
+      .implicit_value(true);
 
   parser.parse_args(argc, argv);
 
@@ -264,86 +96,107 @@ static void setup(int argc, char *argv[]) {
     PLOG_WARNING << "You probably want to run this as root.";
   }
 
-  {
-    using namespace frame_task;
-
-    frame_endpoint = parser.get<std::string>("--frame-endpoint");
-
-    static rgb_matrix::RGBMatrix::Options matrix_opts;
-    static rgb_matrix::RuntimeOptions matrix_runtime_opts;
-
-    matrix_opts.rows = parser.get<int>("--rows");
-    matrix_opts.cols = parser.get<int>("--cols");
-    matrix_opts.chain_length = parser.get<int>("--chain-length");
-    matrix_opts.parallel = parser.get<int>("--parallel");
-
-    if (parser.present("--pixel-mapper")) {
-      static std::string matrix_opts_pixel_mapper =
-          std::string(parser.get<std::string>("--pixel-mapper"));
-      matrix_opts.pixel_mapper_config = matrix_opts_pixel_mapper.c_str();
-    }
-
-    if (parser.present("--hardware-mapping")) {
-      static std::string matrix_opts_led_rgb_sequence =
-          std::string(parser.get<std::string>("--hardware-mapping"));
-      matrix_opts.hardware_mapping = matrix_opts_led_rgb_sequence.c_str();
-    }
+  server_options.frame_endpoint = parser.get<std::string>("--frame-endpoint");
+  server_options.control_endpoint = parser.get<std::string>("--control-endpoint");
+  server_options.frame_socket_options = frame_socket::options_from_args(parser);
+  if (parser.get<bool>("--shm")) {
+    server_options.shm_name = parser.get<std::string>("--shm-name");
+  }
+  server_options.frame_cache_bytes =
+      static_cast<std::size_t>(std::max(parser.get<int>("--frame-cache-mb"), 0)) << 20;
+  server_options.sync_endpoint = parser.present("--sync-endpoint").value_or("");
+  server_options.sync_timeout = std::chrono::milliseconds(parser.get<int>("--sync-timeout-ms"));
+
+  static rgb_matrix::RGBMatrix::Options matrix_opts;
+  static rgb_matrix::RuntimeOptions matrix_runtime_opts;
+
+  matrix_opts.rows = parser.get<int>("--rows");
+  matrix_opts.cols = parser.get<int>("--cols");
+  matrix_opts.chain_length = parser.get<int>("--chain-length");
+  matrix_opts.parallel = parser.get<int>("--parallel");
+
+  if (parser.present("--pixel-mapper")) {
+    static std::string matrix_opts_pixel_mapper =
+        std::string(parser.get<std::string>("--pixel-mapper"));
+    matrix_opts.pixel_mapper_config = matrix_opts_pixel_mapper.c_str();
+  }
 
-    matrix_opts.pwm_lsb_nanoseconds = parser.get<int>("--pwm-lsb-ns");
-    matrix_opts.pwm_bits = parser.get<int>("--pwm-bits");
-    matrix_opts.pwm_dither_bits = parser.get<int>("--pwm-dither-bits");
+  if (parser.present("--hardware-mapping")) {
+    static std::string matrix_opts_led_rgb_sequence =
+        std::string(parser.get<std::string>("--hardware-mapping"));
+    matrix_opts.hardware_mapping = matrix_opts_led_rgb_sequence.c_str();
+  }
 
-    matrix_opts.limit_refresh_rate_hz = parser.get<int>("--limit-hz");
-    matrix_opts.show_refresh_rate = parser.get<bool>("--show-hz");
+  matrix_opts.pwm_lsb_nanoseconds = parser.get<int>("--pwm-lsb-ns");
+  matrix_opts.pwm_bits = parser.get<int>("--pwm-bits");
+  matrix_opts.pwm_dither_bits = parser.get<int>("--pwm-dither-bits");
 
-    matrix_runtime_opts.daemon = 0;
-    matrix_runtime_opts.drop_privileges = 0;
-    matrix_runtime_opts.gpio_slowdown = parser.get<int>("--gpio-slowdown");
+  matrix_opts.limit_refresh_rate_hz = parser.get<int>("--limit-hz");
+  matrix_opts.show_refresh_rate = parser.get<bool>("--show-hz");
 
-    matrix = rgb_matrix::RGBMatrix::CreateFromOptions(matrix_opts, matrix_runtime_opts);
-    matrix->set_luminance_correct(true);
+  matrix_runtime_opts.daemon = 0;
+  matrix_runtime_opts.drop_privileges = 0;
+  matrix_runtime_opts.gpio_slowdown = parser.get<int>("--gpio-slowdown");
 
-    matrix_width = matrix->width();
-    matrix_height = matrix->height();
-    frame_buffer.resize(matrix_width * matrix_height * consts::bpp);
+  auto brightness_arg = parser.get<int>("--brightness");
+  if (brightness_arg < 0 || brightness_arg > 255) {
+    std::cerr << "Invalid brightness value: " << brightness_arg << std::endl;
+    std::exit(1);
+  } else {
+    server_options.brightness = brightness_arg;
+  }
 
-    auto brightness_arg = parser.get<int>("--brightness");
-    if (brightness_arg < 0 || brightness_arg > 255) {
-      std::cerr << "Invalid brightness value: " << brightness_arg << std::endl;
-      std::exit(1);
-    } else {
-      brightness_current = brightness_arg;
-    }
+  auto color_temp_arg = parser.get<int>("--temperature");
+  if (color_temp_arg < color_temp::min || color_temp_arg > color_temp::max) {
+    std::cerr << "Invalid temperature value: " << color_temp_arg << std::endl;
+    std::exit(1);
+  } else {
+    server_options.temperature = color_temp_arg;
+  }
 
-    auto color_temp_arg = parser.get<int>("--temperature");
-    if (color_temp_arg < color_temp::min || color_temp_arg > color_temp::max) {
-      std::cerr << "Invalid temperature value: " << color_temp_arg << std::endl;
+  if (parser.present("--calibration")) {
+    try {
+      server_options.calibration = calibration::load(parser.get<std::string>("--calibration"));
+    } catch (const std::runtime_error &err) {
+      std::cerr << err.what() << std::endl;
       std::exit(1);
-    } else {
-      color_temp_current_k = color_temp_arg;
-      color_temp_current = color_temp::get(color_temp_current_k);
     }
-
-    if (!parser.get<bool>("--no-test-pattern")) {
-      render_test_pattern();
-      update_matrix();
+  }
+  try {
+    server_options.frame_thread = thread_tuning::settings_from_args(parser, "frame");
+    server_options.render_thread = thread_tuning::settings_from_args(parser, "render");
+    server_options.control_thread = thread_tuning::settings_from_args(parser, "control");
+    server_options.sync_thread = thread_tuning::settings_from_args(parser, "sync");
+    if (const auto cpus = parser.present("--zmq-io-cpus")) {
+      server_options.zmq_io_cpus = thread_tuning::parse_cpus(*cpus);
     }
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::exit(1);
   }
+  server_options.measure_jitter = parser.get<bool>("--measure-jitter");
 
-  {
-    using namespace control_task;
-    control_endpoint = parser.get<std::string>("--control-endpoint");
-  }
+  server_options.panel_width = matrix_opts.cols;
+  server_options.panel_height = matrix_opts.rows;
+
+  server_options.test_pattern = !parser.get<bool>("--no-test-pattern");
+  server_options.defer_control_replies = parser.get<bool>("--defer-control-replies");
+
+  auto *matrix = rgb_matrix::RGBMatrix::CreateFromOptions(matrix_opts, matrix_runtime_opts);
+  canvas = std::make_unique<lmz::RgbMatrixCanvas>(matrix);
 }
 
 int main(int argc, char *argv[]) {
   setup(argc, argv);
 
-  auto frame_thread = std::thread(frame_task::loop);
-  auto control_thread = std::thread(control_task::loop);
-
-  frame_thread.join();
-  control_thread.join();
+  try {
+    lmz::Server server(*canvas, server_options);
+    server.start();
+    server.wait();
+  } catch (const std::runtime_error &err) {
+    PLOG_FATAL << err.what();
+    return 1;
+  }
 
   return 0;
 }
@@ -0,0 +1,256 @@
+#include "shm_ring.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <plog/Log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "consts.hpp"
+
+namespace {
+
+constexpr std::uint32_t ring_magic = 0x525A4D4C; // "LMZR", little endian
+constexpr std::uint32_t ring_version = 1;
+
+constexpr std::uint32_t slot_count = 3;
+constexpr std::uint32_t index_mask = 0x03;
+constexpr std::uint32_t fresh_bit = 0x04;
+
+// Slots start on a cache line, after a line holding when the frame was published.
+constexpr std::size_t slot_align = 64;
+
+std::size_t slot_stride(std::size_t frame_size) {
+  return slot_align + (frame_size + slot_align - 1) / slot_align * slot_align;
+}
+
+std::runtime_error shm_error(const std::string &what, const std::string &name) {
+  return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+// Lives at the start of the segment, so only fixed-size fields and lock-free atomics.
+struct lmz::ShmRing::Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint64_t stride;
+
+  std::atomic<std::uint32_t> middle;      // Slot index and fresh bit, as in TripleBuffer
+  std::atomic<std::uint32_t> write_index; // Kept here so a restarted producer carries on
+  std::atomic<std::uint32_t> doorbell;    // Futex word, bumped on every publish
+  std::atomic<std::uint32_t> sleeping;    // Whether the server may be waiting on the doorbell
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+static_assert(std::atomic<std::int64_t>::is_always_lock_free);
+
+namespace {
+
+std::atomic<std::int64_t> &published_ns(std::byte *slot) {
+  return *reinterpret_cast<std::atomic<std::int64_t> *>(slot - slot_align);
+}
+
+// Not the private futex ops, those only work within one process.
+long futex(std::atomic<std::uint32_t> &word, int op, std::uint32_t value,
+           const timespec *timeout) {
+  static_assert(sizeof(word) == sizeof(std::uint32_t));
+  return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), op, value, timeout,
+                 nullptr, 0);
+}
+
+} // namespace
+
+lmz::ShmRing::ShmRing(std::string name, void *memory, std::size_t size, bool owner)
+    : name(std::move(name)), memory(memory), size(size), owner(owner),
+      header(static_cast<Header *>(memory)), frame_width(header->width),
+      frame_height(header->height), stride(header->stride), read_index(1) {}
+
+lmz::ShmRing lmz::ShmRing::create(const std::string &name, int width, int height) {
+  static_assert(sizeof(Header) <= slot_align);
+
+  const std::size_t frame_size = width * height * consts::pixel_size;
+  const auto stride = slot_stride(frame_size);
+  const auto size = slot_align + slot_count * stride;
+
+  // Whatever an earlier server left behind may have another size or a stuck producer.
+  shm_unlink(name.c_str());
+  const auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+  if (fd < 0) {
+    throw shm_error("Could not create shared memory", name);
+  }
+
+  void *memory = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    const auto err = shm_error("Could not map shared memory", name);
+    shm_unlink(name.c_str());
+    throw err;
+  }
+
+  // The segment starts zeroed. The magic goes in last, so a producer never maps a half-made ring.
+  auto *header = new (memory) Header{};
+  header->version = ring_version;
+  header->width = width;
+  header->height = height;
+  header->stride = stride;
+  header->write_index = 0;
+  header->middle = 2;
+  std::atomic_ref(header->magic).store(ring_magic, std::memory_order_release);
+
+  return ShmRing(name, memory, size, true);
+}
+
+lmz::ShmRing lmz::ShmRing::open(const std::string &name) {
+  const auto fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    throw shm_error("Could not open shared memory", name);
+  }
+
+  struct stat status;
+  void *memory = MAP_FAILED;
+  if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= slot_align) {
+    memory = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    throw shm_error("Could not map shared memory", name);
+  }
+
+  ShmRing ring(name, memory, status.st_size, false);
+  const auto *header = ring.header;
+  if (std::atomic_ref(ring.header->magic).load(std::memory_order_acquire) != ring_magic ||
+      header->version != ring_version ||
+      ring.stride != slot_stride(ring.frame_size()) ||
+      ring.size < slot_align + slot_count * ring.stride) {
+    throw std::runtime_error("Shared memory " + name + " is not a frame ring");
+  }
+
+  return ring;
+}
+
+lmz::ShmRing::ShmRing(ShmRing &&other) noexcept
+    : name(std::move(other.name)), memory(std::exchange(other.memory, nullptr)),
+      size(other.size), owner(other.owner), header(other.header), frame_width(other.frame_width),
+      frame_height(other.frame_height), stride(other.stride), read_index(other.read_index) {}
+
+lmz::ShmRing &lmz::ShmRing::operator=(ShmRing &&other) noexcept {
+  std::swap(name, other.name);
+  std::swap(memory, other.memory);
+  std::swap(size, other.size);
+  std::swap(owner, other.owner);
+  std::swap(header, other.header);
+  std::swap(frame_width, other.frame_width);
+  std::swap(frame_height, other.frame_height);
+  std::swap(stride, other.stride);
+  std::swap(read_index, other.read_index);
+  return *this;
+}
+
+lmz::ShmRing::~ShmRing() {
+  if (!memory) {
+    return;
+  }
+
+  munmap(memory, size);
+  if (owner) {
+    shm_unlink(name.c_str());
+  }
+}
+
+int lmz::ShmRing::width() const { return frame_width; }
+int lmz::ShmRing::height() const { return frame_height; }
+std::size_t lmz::ShmRing::frame_size() const {
+  return std::size_t{frame_width} * frame_height * consts::pixel_size;
+}
+
+std::byte *lmz::ShmRing::slot(std::uint32_t index) const {
+  return static_cast<std::byte *>(memory) + slot_align + index * stride + slot_align;
+}
+
+std::span<std::byte> lmz::ShmRing::write_frame() {
+  return {slot(header->write_index.load(std::memory_order_relaxed) % slot_count), frame_size()};
+}
+
+bool lmz::ShmRing::publish() {
+  const auto write_index = header->write_index.load(std::memory_order_relaxed) % slot_count;
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  published_ns(slot(write_index))
+      .store(std::chrono::nanoseconds(now).count(), std::memory_order_relaxed);
+
+  const auto previous = header->middle.exchange(write_index | fresh_bit, std::memory_order_acq_rel);
+  header->write_index.store(previous & index_mask, std::memory_order_relaxed);
+
+  // Paired with wait(): either the server sees the new count, or this sees it sleeping.
+  header->doorbell.fetch_add(1, std::memory_order_seq_cst);
+  if (header->sleeping.load(std::memory_order_seq_cst)) {
+    futex(header->doorbell, FUTEX_WAKE, 1, nullptr);
+  }
+
+  return (previous & fresh_bit) != 0;
+}
+
+bool lmz::ShmRing::consume() {
+  if ((header->middle.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+    return false;
+  }
+
+  // The segment is writable by any process allowed to produce, so an index pointing past the
+  // slots is dropped rather than trusted. Hand the producer a slot that isn't being read instead.
+  const auto index = header->middle.exchange(read_index, std::memory_order_acq_rel) & index_mask;
+  if (index >= slot_count) {
+    PLOG_ERROR << "Shared memory " << name << " published invalid slot " << index;
+
+    auto expected = read_index;
+    header->middle.compare_exchange_strong(expected, (read_index + 1) % slot_count,
+                                           std::memory_order_relaxed);
+    return false;
+  }
+
+  read_index = index;
+  return true;
+}
+
+std::span<const std::byte> lmz::ShmRing::read_frame() const {
+  return {slot(read_index), frame_size()};
+}
+
+std::chrono::steady_clock::time_point lmz::ShmRing::read_published() const {
+  const auto ns = published_ns(slot(read_index)).load(std::memory_order_relaxed);
+  return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ns));
+}
+
+std::uint32_t lmz::ShmRing::published() const {
+  return header->doorbell.load(std::memory_order_acquire);
+}
+
+void lmz::ShmRing::wait(std::uint32_t seen, std::chrono::milliseconds timeout) {
+  const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+  const timespec relative = {
+      .tv_sec = seconds.count(),
+      .tv_nsec = std::chrono::nanoseconds(timeout - seconds).count(),
+  };
+
+  header->sleeping.store(1, std::memory_order_seq_cst);
+  if (header->doorbell.load(std::memory_order_seq_cst) == seen) {
+    // Returns straight away if the doorbell moved on in the meantime.
+    futex(header->doorbell, FUTEX_WAIT, seen, &relative);
+  }
+  header->sleeping.store(0, std::memory_order_relaxed);
+}
+
+void lmz::ShmRing::wake() { futex(header->doorbell, FUTEX_WAKE, 1, nullptr); }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace lmz {
+
+// Hands frames from a producer on the same host to the server through POSIX shared memory, with
+// no socket, kernel copy or message allocation in between. The segment holds three frame slots
+// exchanged like a TripleBuffer: the producer always has a slot to write, the server renders the
+// newest published one straight from shared memory, and frames it never got to are superseded.
+// A futex in the segment is the doorbell that wakes the server.
+//
+// Only one producer may write at a time. The server creates the segment and removes it again.
+class ShmRing {
+public:
+  // Server side. Creates and maps segment `name`, e.g. "/lmz-frames", replacing a stale one.
+  static ShmRing create(const std::string &name, int width, int height);
+
+  // Producer side. Maps the server's segment. Throws std::runtime_error if there is none.
+  static ShmRing open(const std::string &name);
+
+  ShmRing(ShmRing &&other) noexcept;
+  ShmRing &operator=(ShmRing &&other) noexcept;
+  ~ShmRing();
+
+  int width() const;
+  int height() const;
+  std::size_t frame_size() const;
+
+  // Producer side. Write the next RGBA32 frame into this, then publish it. Returns true if that
+  // superseded a frame the server never picked up.
+  std::span<std::byte> write_frame();
+  bool publish();
+
+  // Consumer side. Swaps in the newest published frame, if there is one since the last call. The
+  // frame stays valid until the next successful consume(). Nothing the producer writes to the
+  // segment can make it read outside its own slots.
+  bool consume();
+  std::span<const std::byte> read_frame() const;
+  std::chrono::steady_clock::time_point read_published() const;
+
+  // Consumer side. How many frames have been published, and a wait for that to move on from
+  // `seen`. Returns early on wake() or after `timeout`.
+  std::uint32_t published() const;
+  void wait(std::uint32_t seen, std::chrono::milliseconds timeout);
+
+  // Wakes a wait() from any thread, e.g. to shut down.
+  void wake();
+
+private:
+  struct Header;
+
+  ShmRing(std::string name, void *memory, std::size_t size, bool owner);
+  std::byte *slot(std::uint32_t index) const;
+
+  std::string name;
+  void *memory;
+  std::size_t size;
+  bool owner;
+  Header *header;
+
+  // Copied out of the header once it's validated, as another process could change it later.
+  std::uint32_t frame_width;
+  std::uint32_t frame_height;
+  std::size_t stride;
+
+  std::uint32_t read_index;
+};
+
+} // namespace lmz
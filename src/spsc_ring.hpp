@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lmz {
+
+// Single-producer, single-consumer ring of preallocated slots. Unlike TripleBuffer nothing is
+// ever superseded: the producer waits for room and the consumer sees every slot in order. The
+// producer closes the ring once it is done, after which the consumer drains what is left.
+template <typename T> class SpscRing {
+public:
+  SpscRing(std::size_t capacity, const T &value) : slots(capacity, value) {}
+
+  // Producer side. The next free slot, or nullptr if the ring is full.
+  T *write_slot() {
+    const auto count = head.load(std::memory_order_relaxed) & count_mask;
+    if (count - tail.load(std::memory_order_acquire) == slots.size()) {
+      return nullptr;
+    }
+
+    return &slots[count % slots.size()];
+  }
+
+  // Producer side. Hands the slot from write_slot() over to the consumer.
+  void push() {
+    head.fetch_add(1, std::memory_order_release);
+    head.notify_one();
+  }
+
+  // Producer side. Blocks until write_slot() has a slot to give.
+  void wait_for_space() const {
+    const auto count = head.load(std::memory_order_relaxed) & count_mask;
+    auto current = tail.load(std::memory_order_acquire);
+    while (count - current == slots.size()) {
+      tail.wait(current, std::memory_order_acquire);
+      current = tail.load(std::memory_order_acquire);
+    }
+  }
+
+  // Producer side. No more slots will be pushed.
+  void close() {
+    head.fetch_or(closed_bit, std::memory_order_release);
+    head.notify_one();
+  }
+
+  // Consumer side. The oldest pushed slot, or nullptr if there is none.
+  T *read_slot() {
+    const auto current = tail.load(std::memory_order_relaxed);
+    if ((head.load(std::memory_order_acquire) & count_mask) == current) {
+      return nullptr;
+    }
+
+    return &slots[current % slots.size()];
+  }
+
+  // Consumer side. Gives the slot from read_slot() back to the producer.
+  void pop() {
+    tail.fetch_add(1, std::memory_order_release);
+    tail.notify_one();
+  }
+
+  // Consumer side. Blocks until read_slot() has a slot to give, or returns false if the ring is
+  // closed and empty.
+  bool wait_for_data() const {
+    const auto current = tail.load(std::memory_order_relaxed);
+    auto value = head.load(std::memory_order_acquire);
+    while ((value & count_mask) == current) {
+      if (value & closed_bit) {
+        return false;
+      }
+
+      head.wait(value, std::memory_order_acquire);
+      value = head.load(std::memory_order_acquire);
+    }
+
+    return true;
+  }
+
+  // Consumer side. Number of slots waiting to be read.
+  std::size_t size() const {
+    return (head.load(std::memory_order_acquire) & count_mask) -
+           tail.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr std::uint64_t closed_bit = std::uint64_t(1) << 63;
+  static constexpr std::uint64_t count_mask = closed_bit - 1;
+
+  std::vector<T> slots;
+
+  // Slots pushed and popped so far. The producer's closed flag lives in the top bit of head so
+  // that closing wakes a waiting consumer.
+  std::atomic<std::uint64_t> head = 0;
+  std::atomic<std::uint64_t> tail = 0;
+};
+
+} // namespace lmz
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "messages.hpp"
+
+namespace stats {
+
+constexpr auto histogram_buckets = lmz::stats_histogram_buckets;
+
+// Lock-free histogram of durations in power-of-two microsecond buckets.
+class Histogram {
+public:
+  void record(std::chrono::nanoseconds duration) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    const auto bucket = us <= 0 ? 0 : std::bit_width(static_cast<std::uint64_t>(us)) - 1;
+    buckets[std::min<std::size_t>(bucket, histogram_buckets - 1)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  std::array<std::uint64_t, histogram_buckets> snapshot() const {
+    std::array<std::uint64_t, histogram_buckets> out;
+    for (std::size_t i = 0; i < histogram_buckets; ++i) {
+      out[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+
+    return out;
+  }
+
+  void reset() {
+    for (auto &bucket : buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, histogram_buckets> buckets{};
+};
+
+// Message structs are packed, so histogram arrays in them are copied rather than referenced.
+inline void copy_to_message(const std::array<std::uint64_t, histogram_buckets> &buckets,
+                            void *message_buckets) {
+  std::memcpy(message_buckets, buckets.data(), sizeof(buckets));
+}
+
+inline std::array<std::uint64_t, histogram_buckets> copy_from_message(const void *message_buckets) {
+  std::array<std::uint64_t, histogram_buckets> buckets;
+  std::memcpy(buckets.data(), message_buckets, sizeof(buckets));
+  return buckets;
+}
+
+// Upper bound in microseconds of the bucket holding the `quantile` (0-1) sample, or 0 if there
+// are no samples.
+inline std::uint64_t percentile_us(std::span<const std::uint64_t, histogram_buckets> buckets,
+                                   double quantile) {
+  std::uint64_t total = 0;
+  for (const auto count : buckets) {
+    total += count;
+  }
+
+  if (total == 0) {
+    return 0;
+  }
+
+  const auto target = static_cast<std::uint64_t>(quantile * (total - 1)) + 1;
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < histogram_buckets; ++i) {
+    seen += buckets[i];
+    if (seen >= target) {
+      return std::uint64_t(2) << i;
+    }
+  }
+
+  return std::uint64_t(2) << (histogram_buckets - 1);
+}
+
+} // namespace stats
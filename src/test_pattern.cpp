@@ -0,0 +1,13 @@
+#include "test_pattern.hpp"
+
+void test_pattern::render(std::span<std::uint32_t> pixels, int width, int height) {
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      auto b = (y * 255) / height;
+      auto g = (x * 255) / width;
+      auto r = 255 - b;
+
+      pixels[y * width + x] = (r << 0) | (g << 8) | (b << 16);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace test_pattern {
+
+// Fills `pixels` (width * height RGBA32) with the startup gradient.
+void render(std::span<std::uint32_t> pixels, int width, int height);
+
+} // namespace test_pattern
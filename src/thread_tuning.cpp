@@ -0,0 +1,106 @@
+#include "thread_tuning.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <plog/Log.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+void thread_tuning::apply(const Settings &settings, const std::string &name) {
+  // Thread names are limited to 15 characters.
+  pthread_setname_np(pthread_self(), ("lmz-" + name).substr(0, 15).c_str());
+
+  if (!settings.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (const auto cpu : settings.cpus) {
+      CPU_SET(cpu, &cpus);
+    }
+
+    if (const auto err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); err != 0) {
+      PLOG_WARNING << "Could not pin the " << name << " thread: " << std::strerror(err);
+    }
+  }
+
+  if (settings.fifo_priority > 0) {
+    const sched_param param = {.sched_priority = settings.fifo_priority};
+    if (const auto err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0) {
+      PLOG_WARNING << "Could not run the " << name << " thread SCHED_FIFO: " << std::strerror(err);
+    }
+  }
+
+  // On Linux nice is per thread, addressed by its thread ID.
+  if (settings.nice && setpriority(PRIO_PROCESS, gettid(), *settings.nice) != 0) {
+    PLOG_WARNING << "Could not renice the " << name << " thread: " << std::strerror(errno);
+  }
+
+  PLOG_DEBUG << "Started the " << name << " thread";
+}
+
+std::vector<int> thread_tuning::parse_cpus(const std::string &list) {
+  const auto cpu_count = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+  std::vector<int> cpus;
+
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    int first, last;
+    char dash;
+    std::istringstream words(range);
+    if (!(words >> first)) {
+      throw std::runtime_error("Invalid CPU list: " + list);
+    }
+    last = first;
+    if ((words >> dash && (dash != '-' || !(words >> last))) || first < 0 || last < first) {
+      throw std::runtime_error("Invalid CPU list: " + list);
+    }
+
+    if (last >= std::min(cpu_count, CPU_SETSIZE)) {
+      throw std::runtime_error("CPU list " + list + " is outside the " +
+                               std::to_string(cpu_count) + " CPUs of this machine");
+    }
+    for (auto cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
+void thread_tuning::add_arguments(argparse::ArgumentParser &parser, const std::string &thread) {
+  parser.add_argument("--" + thread + "-cpus")
+      .help("CPUs to pin the " + thread + " thread to, e.g. 0-2");
+  parser.add_argument("--" + thread + "-priority")
+      .help("SCHED_FIFO priority for the " + thread + " thread (1-99), 0 for SCHED_OTHER")
+      .default_value(0)
+      .scan<'i', int>();
+  parser.add_argument("--" + thread + "-nice")
+      .help("Nice value for the " + thread + " thread (-20 to 19)")
+      .scan<'i', int>();
+}
+
+thread_tuning::Settings thread_tuning::settings_from_args(const argparse::ArgumentParser &parser,
+                                                          const std::string &thread) {
+  Settings settings;
+  if (const auto cpus = parser.present("--" + thread + "-cpus")) {
+    settings.cpus = parse_cpus(*cpus);
+  }
+
+  settings.fifo_priority = parser.get<int>("--" + thread + "-priority");
+  if (settings.fifo_priority < 0 || settings.fifo_priority > 99) {
+    throw std::runtime_error("The " + thread + " thread priority must be 0-99");
+  }
+
+  settings.nice = parser.present<int>("--" + thread + "-nice");
+  if (settings.nice && (*settings.nice < -20 || *settings.nice > 19)) {
+    throw std::runtime_error("The " + thread + " thread nice value must be -20 to 19");
+  }
+
+  return settings;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+// CPU affinity and scheduling for the server's threads, to keep them off the cores the panel
+// refresh thread needs.
+namespace thread_tuning {
+
+struct Settings {
+  std::vector<int> cpus;   // Cores to pin to, empty for any
+  int fifo_priority = 0;   // 1-99 runs the thread SCHED_FIFO, 0 leaves it SCHED_OTHER
+  std::optional<int> nice; // Nice value for SCHED_OTHER, -20 to 19
+};
+
+// Names the calling thread and applies `settings` to it. Failures, usually missing privileges,
+// are logged and otherwise ignored.
+void apply(const Settings &settings, const std::string &name);
+
+// Parses a CPU list such as "3", "2,3" or "0-2". Throws std::runtime_error.
+std::vector<int> parse_cpus(const std::string &list);
+
+// Adds --<thread>-cpus, --<thread>-priority and --<thread>-nice.
+void add_arguments(argparse::ArgumentParser &parser, const std::string &thread);
+Settings settings_from_args(const argparse::ArgumentParser &parser, const std::string &thread);
+
+} // namespace thread_tuning
@@ -0,0 +1,64 @@
+#include "tile_layout.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Keeps the canvas, and so the proxy's frame size, well within an int.
+constexpr int max_edge = 16384;
+
+} // namespace
+
+tile_layout::Layout tile_layout::parse(std::istream &in) {
+  Layout layout{.width = 0, .height = 0, .nodes = {}};
+
+  std::string line;
+  for (auto line_number = 1; std::getline(in, line); ++line_number) {
+    std::istringstream words(line.substr(0, line.find('#')));
+
+    std::string keyword;
+    if (!(words >> keyword)) {
+      continue;
+    }
+
+    Node node;
+    std::string extra;
+    if (keyword != "node" ||
+        !(words >> node.endpoint >> node.x >> node.y >> node.width >> node.height) ||
+        words >> extra || node.x < 0 || node.y < 0 || node.width <= 0 || node.height <= 0 ||
+        node.x > max_edge - node.width || node.y > max_edge - node.height) {
+      throw std::runtime_error("Layout line " + std::to_string(line_number) +
+                               ": expected node ENDPOINT X Y WIDTH HEIGHT");
+    }
+
+    layout.width = std::max(layout.width, node.x + node.width);
+    layout.height = std::max(layout.height, node.y + node.height);
+    layout.nodes.push_back(std::move(node));
+  }
+
+  if (layout.nodes.empty()) {
+    throw std::runtime_error("Layout has no nodes");
+  }
+
+  return layout;
+}
+
+tile_layout::Layout tile_layout::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Could not open layout: " + path);
+  }
+
+  return parse(file);
+}
+
+void tile_layout::cut(const std::uint32_t *canvas, int canvas_width, const Node &node,
+                      std::uint32_t *tile) {
+  for (auto y = 0; y < node.height; ++y) {
+    const auto *row = canvas + (node.y + y) * canvas_width + node.x;
+    std::copy_n(row, node.width, tile + y * node.width);
+  }
+}
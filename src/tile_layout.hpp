@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// How one large virtual canvas is split between several servers.
+namespace tile_layout {
+
+// One server and the part of the canvas it shows.
+struct Node {
+  std::string endpoint;
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// The canvas is the bounding box of its nodes.
+struct Layout {
+  int width;
+  int height;
+  std::vector<Node> nodes;
+};
+
+// Reads one node per line, e.g.:
+//
+//   # endpoint x y width height
+//   node tcp://wall-left.local:42024 0 0 128 64
+//   node tcp://wall-right.local:42024 128 0 128 64
+//
+// Throws std::runtime_error on anything it doesn't understand, if a node reaches past 16384 pixels
+// in either direction, or if there are no nodes.
+Layout parse(std::istream &in);
+Layout load(const std::string &path);
+
+// Copies `node`'s part of an RGBA32 canvas `canvas_width` pixels wide into `tile`.
+void cut(const std::uint32_t *canvas, int canvas_width, const Node &node, std::uint32_t *tile);
+
+} // namespace tile_layout
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace lmz {
+
+// Single-producer, single-consumer triple buffer. The producer always has a free slot to write
+// into and the consumer always picks up the newest published slot; frames published while the
+// consumer was busy are superseded rather than queued. Neither side ever takes a lock.
+template <typename T> class TripleBuffer {
+public:
+  // Sets every slot to `value`. Not thread-safe, only call this before either side starts.
+  void reset(const T &value) {
+    slots.fill(value);
+    write_index = 0;
+    read_index = 1;
+    middle.store(2, std::memory_order_relaxed);
+  }
+
+  T &write_slot() { return slots[write_index]; }
+  const T &read_slot() const { return slots[read_index]; }
+
+  // Producer side. Makes the write slot the newest frame and takes the previous middle slot as
+  // the next write slot. Returns true if that slot held a frame the consumer never picked up.
+  bool publish() {
+    const auto previous =
+        middle.exchange(static_cast<std::uint8_t>(write_index | fresh_bit), std::memory_order_acq_rel);
+    write_index = previous & index_mask;
+    middle.notify_one();
+
+    return (previous & fresh_bit) != 0;
+  }
+
+  // Consumer side. Swaps in the newest published frame, if there is one since the last call.
+  bool consume() {
+    if ((middle.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+      return false;
+    }
+
+    const auto previous = middle.exchange(read_index, std::memory_order_acq_rel);
+    read_index = previous & index_mask;
+
+    return true;
+  }
+
+  // Consumer side. Blocks until a frame has been published that has not been consumed yet.
+  void wait() const {
+    auto current = middle.load(std::memory_order_acquire);
+    while ((current & fresh_bit) == 0) {
+      middle.wait(current, std::memory_order_acquire);
+      current = middle.load(std::memory_order_acquire);
+    }
+  }
+
+private:
+  static constexpr std::uint8_t index_mask = 0x03;
+  static constexpr std::uint8_t fresh_bit = 0x04;
+
+  std::array<T, 3> slots;
+
+  std::uint8_t write_index = 0;
+  std::uint8_t read_index = 1;
+  std::atomic<std::uint8_t> middle = 2;
+};
+
+} // namespace lmz
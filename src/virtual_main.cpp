@@ -1,18 +1,25 @@
 #include <SDL_pixels.h>
+#include <algorithm>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <SDL.h>
 #include <argparse/argparse.hpp>
 #include <zmq.hpp>
 
 #include "consts.hpp"
+#include "frame_decoder.hpp"
+#include "frame_socket.hpp"
 
 class Options {
 public:
   std::string frame_endpoint;
+  frame_socket::Options frame_socket_options;
   int width;
   int height;
   int scale;
+  int frame_cache_mb;
 
   static Options from_args(int argc, char *argv[]) {
     argparse::ArgumentParser parser("led-matrix-zmq-virtual");
@@ -20,15 +27,19 @@ public:
     parser.add_argument("--width").default_value(32).scan<'i', int>();
     parser.add_argument("--height").default_value(32).scan<'i', int>();
     parser.add_argument("--scale").default_value(-1).scan<'i', int>();
+    parser.add_argument("--frame-cache-mb").default_value(16).scan<'i', int>();
     parser.add_argument("--frame-endpoint").default_value(consts::default_frame_endpoint);
+    frame_socket::add_arguments(parser);
 
     parser.parse_args(argc, argv);
 
     return Options{
         .frame_endpoint = parser.get<std::string>("--frame-endpoint"),
+        .frame_socket_options = frame_socket::options_from_args(parser),
         .width = parser.get<int>("--width"),
         .height = parser.get<int>("--height"),
         .scale = parser.get<int>("--scale"),
+        .frame_cache_mb = parser.get<int>("--frame-cache-mb"),
     };
     ;
   }
@@ -61,9 +72,13 @@ int main(int argc, char *argv[]) {
                                     options.width, options.height);
 
   zmq::context_t zmq_ctx;
-  zmq::socket_t zmq_sock(zmq_ctx, zmq::socket_type::rep);
+  auto zmq_sock = frame_socket::make_receiver(zmq_ctx, options.frame_socket_options);
   zmq_sock.bind(options.frame_endpoint);
 
+  std::vector<std::byte> frame(options.width * options.height * consts::pixel_size);
+  lmz::FrameDecoder decoder(options.width, options.height,
+                            static_cast<std::size_t>(std::max(options.frame_cache_mb, 0)) << 20);
+
   auto running = true;
   while (running) {
     SDL_Event event;
@@ -79,13 +94,20 @@ int main(int argc, char *argv[]) {
 
     zmq::message_t req;
     static_cast<void>(zmq_sock.recv(req, zmq::recv_flags::none));
-    zmq_sock.send(zmq::message_t(), zmq::send_flags::none);
 
-    if (req.size() != options.width * options.height * consts::pixel_size) {
-      throw std::runtime_error("Invalid frame size");
+    const auto data = std::span<const std::byte>(req.data<const std::byte>(), req.size());
+    const auto cached_hash = lmz::get_cached_frame_hash(data);
+    if (!cached_hash) {
+      frame_socket::acknowledge_frame(zmq_sock, options.frame_socket_options);
+    }
+
+    decoder.decode(data, frame);
+    if (cached_hash) {
+      frame_socket::acknowledge_cached_frame(zmq_sock, options.frame_socket_options, *cached_hash,
+                                             decoder.cache_hit().value_or(false));
     }
 
-    std::memcpy(tex_pixels, req.data(), req.size());
+    std::memcpy(tex_pixels, frame.data(), frame.size());
 
     SDL_UnlockTexture(texture);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
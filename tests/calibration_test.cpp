@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calibration.hpp"
+#include "color_lut.hpp"
+#include "pixel_kernel.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+calibration::Calibration parse(const std::string &text) {
+  std::istringstream in(text);
+  return calibration::parse(in);
+}
+
+bool parses(const std::string &text) {
+  try {
+    parse(text);
+    return true;
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+}
+
+bool compiles(const std::string &text, int width, int height) {
+  try {
+    calibration::Compiled(parse(text), width, height, 64, 32);
+    return true;
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+}
+
+bool same_curves(const color_lut::Tables &a, const color_lut::Tables &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+calibration::TileCorrection correction(float gain, float gamma) {
+  calibration::TileCorrection correction;
+  correction.gain = {gain, gain, gain};
+  correction.gamma = {gamma, gamma, gamma};
+  return correction;
+}
+
+} // namespace
+
+int main() {
+  try {
+    const auto parsed = parse("# panels from the second batch\n"
+                              "tile-size 64 32\n"
+                              "\n"
+                              "tile 0 0 gain 1.0 0.96 0.92   # warm\n"
+                              "tile 1 0 gain 0.94 1.0 0.97 gamma 1.0 1.0 1.1\n"
+                              "tile 2 1 gamma 2.2 2.2 2.2\n");
+    check(parsed.tile_width == 64 && parsed.tile_height == 32, "tile size");
+    check(parsed.tiles.size() == 3, "tile count");
+    const auto &second = parsed.tiles.at({1, 0});
+    check(second.gain[0] == 0.94f && second.gain[2] == 0.97f && second.gamma[2] == 1.1f,
+          "tile values");
+    const auto &third = parsed.tiles.at({2, 1});
+    check(third.gain[1] == 1.0f && third.gamma[1] == 2.2f, "gain defaults to 1");
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("good calibration: ") + err.what());
+  }
+
+  check(parses(""), "empty calibration");
+  check(parse("tile 0 0\n").tiles.size() == 1, "tile without properties");
+
+  // Malformed tiles.
+  check(!parses("tile\n"), "tile without position");
+  check(!parses("tile 0\n"), "tile without row");
+  check(!parses("tile -1 0 gain 1 1 1\n"), "negative tile column");
+  check(!parses("tile 0 -1 gain 1 1 1\n"), "negative tile row");
+  check(!parses("tile a 0\n"), "tile column not a number");
+  check(!parses("tile 0 0 gain 1 1\n"), "gain with two channels");
+  check(!parses("tile 0 0 gamma 1 x 1\n"), "gamma channel not a number");
+  check(!parses("tile 0 0 gain nan 1 1\n"), "gain of nan");
+  check(!parses("tile 0 0 gamma 1 inf 1\n"), "gamma of inf");
+  check(!parses("tile 0 0 brightness 1 1 1\n"), "unknown property");
+  check(!parses("panel 0 0 gain 1 1 1\n"), "unknown keyword");
+  check(!parses("tile-size 64\n"), "tile size without height");
+  check(!parses("tile-size 0 32\n"), "zero tile width");
+  check(!parses("tile-size 64 -32\n"), "negative tile height");
+
+  try {
+    parse("tile-size 64 32\n\ntile 0 0 gain 1 1\n");
+    check(false, "error without line number");
+  } catch (const std::runtime_error &err) {
+    check(std::string(err.what()).find("line 3") != std::string::npos, "error line number");
+  }
+
+  // Overlapping tiles.
+  check(!parses("tile 1 0 gain 1 1 1\ntile 1 0 gamma 2 2 2\n"), "tile listed twice");
+  check(parses("tile 1 0 gain 1 1 1\ntile 0 1 gamma 2 2 2\n"), "neighbouring tiles");
+
+  // Out of range gains and gammas are parsed, then clamped when the curves are built.
+  try {
+    const auto extreme = parse("tile 0 0 gain 9 -3 1 gamma 0.01 40 -1\n");
+    const auto clamped = calibration::clamp(extreme.tiles.at({0, 0}));
+    check(clamped.gain[0] == 2.0f && clamped.gain[1] == 0.0f && clamped.gain[2] == 1.0f,
+          "gain clamped");
+    check(clamped.gamma[0] == 0.2f && clamped.gamma[1] == 5.0f && clamped.gamma[2] == 0.2f,
+          "gamma clamped");
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("extreme calibration: ") + err.what());
+  }
+
+  check(same_curves(calibration::build_curves(correction(9, 1)),
+                    calibration::build_curves(correction(2, 1))),
+        "gain above range");
+  check(same_curves(calibration::build_curves(correction(-1, 1)),
+                    calibration::build_curves(correction(0, 1))),
+        "gain below range");
+  check(same_curves(calibration::build_curves(correction(1, 0)),
+                    calibration::build_curves(correction(1, 0.2f))),
+        "gamma below range");
+
+  const auto identity = calibration::build_curves(correction(1, 1));
+  auto is_identity = true;
+  for (auto v = 0; v < 256; ++v) {
+    is_identity = is_identity && identity.r[v] == v && identity.g[v] == v && identity.b[v] == v;
+  }
+  check(is_identity, "unity curves");
+
+  const auto doubled = calibration::build_curves(correction(2, 1));
+  check(doubled.r[0] == 0 && doubled.r[100] == 200 && doubled.r[200] == 255, "doubled curve");
+  const auto black = calibration::build_curves(correction(0, 1));
+  check(black.g[255] == 0, "zero gain");
+
+  // Tiles against the canvas: 160x48 in 64x32 tiles is 3x2 tiles, the last ones partial.
+  check(compiles("tile 2 1 gain 1 1 1\n", 160, 48), "last partial tile");
+  check(!compiles("tile 3 0 gain 1 1 1\n", 160, 48), "tile right of the canvas");
+  check(!compiles("tile 0 2 gain 1 1 1\n", 160, 48), "tile below the canvas");
+  check(!compiles("tile-size 80 48\ntile 2 0 gain 1 1 1\n", 160, 48), "tile past its own size");
+  check(compiles("tile 0 0 gain 1 1 1\n", 64, 32), "default tile size");
+
+  calibration::Compiled whole(parse("tile 0 0 gain 1 1 1\n"), 50, 20, 0, 0);
+  check(whole.tile_width() == 50 && whole.tile_height() == 20, "whole canvas tile");
+  check(compiles("tile-size 16 16\ntile 0 0\n", 8, 8), "tile larger than canvas");
+
+  // Only the corrected tile's pixels change: tile 1 0 is columns 64 to 127 of rows 0 to 31.
+  const auto width = 160;
+  const auto height = 48;
+  calibration::Compiled compiled(parse("tile 1 0 gain 0 1 1\n"), width, height, 64, 32);
+  check(compiled.tile_count() == 1 && compiled.tile_width() == 64 &&
+            compiled.tile_height() == 32,
+        "compiled tiles");
+
+  const auto scale = pixel_kernel::make_scale(255, {255, 255, 255});
+  compiled.rescale(scale.tables);
+
+  std::vector<std::uint32_t> src(width, 0xFF405080);
+  std::vector<std::uint32_t> dst(width);
+  std::vector<std::uint32_t> plain(width);
+  pixel_kernel::convert(src.data(), plain.data(), width, scale);
+
+  for (const auto y : {0, 31, 32, 47}) {
+    compiled.convert_row(y, src.data(), dst.data(), width, scale);
+    auto ok = true;
+    for (auto x = 0; x < width; ++x) {
+      const auto corrected = y < 32 && x >= 64 && x < 128;
+      const auto expected = corrected ? plain[x] & 0xFFFFFF00 : plain[x];
+      ok = ok && dst[x] == expected;
+    }
+    check(ok, "row " + std::to_string(y));
+  }
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("calibration OK\n");
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "clip.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+// Writes a clip header followed by `data_bytes` bytes counting up from 0.
+std::string write_clip(const clip::Header &header, std::size_t data_bytes) {
+  char path[] = "/tmp/lmz-clip-test-XXXXXX";
+  const auto fd = mkstemp(path);
+  std::vector<unsigned char> data(sizeof(header) + data_bytes);
+  std::memcpy(data.data(), &header, sizeof(header));
+  for (std::size_t i = 0; i < data_bytes; ++i) {
+    data[sizeof(header) + i] = static_cast<unsigned char>(i);
+  }
+  check(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()), "write clip");
+  close(fd);
+  return path;
+}
+
+bool loads(const clip::Header &header, std::size_t data_bytes) {
+  const auto path = write_clip(header, data_bytes);
+  auto ok = true;
+  try {
+    clip::Clip clip(path);
+  } catch (const std::runtime_error &) {
+    ok = false;
+  }
+  unlink(path.c_str());
+  return ok;
+}
+
+clip::Header header(int width, int height, std::uint32_t frame_count) {
+  return {.magic = clip::magic,
+          .width = static_cast<std::uint16_t>(width),
+          .height = static_cast<std::uint16_t>(height),
+          .frame_count = frame_count,
+          .frame_interval_us = 33333};
+}
+
+} // namespace
+
+int main() {
+  // A good clip maps each frame where the file has it.
+  const auto path = write_clip(header(4, 2, 3), 3 * 4 * 2 * 4);
+  try {
+    clip::Clip clip(path);
+    check(clip.width() == 4 && clip.height() == 2 && clip.frame_count() == 3, "clip header");
+    const auto frame = clip.frame(2);
+    check(frame.size() == 32 && frame[0] == std::byte{64} && frame[31] == std::byte{95},
+          "last frame");
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("good clip: ") + err.what());
+  }
+  unlink(path.c_str());
+
+  check(loads(header(4, 2, 3), 3 * 32 + 5), "clip with trailing bytes");
+  check(!loads(header(4, 2, 3), 3 * 32 - 1), "truncated clip");
+  check(!loads(header(4, 2, 0), 0), "clip without frames");
+  check(!loads(header(0, 2, 1), 0), "clip without pixels");
+
+  auto bad_magic = header(4, 2, 1);
+  bad_magic.magic = 0;
+  check(!loads(bad_magic, 32), "clip with bad magic");
+
+  // 49477 * 27905 * 4 bytes times 3340214413 frames is 2^64 + 4 bytes, which wraps to 4 in a
+  // 64-bit multiplication. So a file with 4 bytes of frame data must still be refused.
+  check(!loads(header(49477, 27905, 3340214413u), 4), "frame count wrapping the size");
+  check(!loads(header(65535, 65535, 0xFFFFFFFF), 64), "largest header");
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("clips OK\n");
+  return 0;
+}
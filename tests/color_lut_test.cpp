@@ -0,0 +1,40 @@
+#include <cstdio>
+#include <tuple>
+
+#include "color_lut.hpp"
+#include "color_temp.hpp"
+
+// The lookup tables must match, bit for bit, the per-pixel arithmetic update_matrix used before
+// them: brightness first, then the temperature factor, each truncating.
+int main() {
+  auto mismatches = 0;
+
+  for (auto kelvin = color_temp::min; kelvin <= color_temp::max; ++kelvin) {
+    const auto temperature = color_temp::get(kelvin);
+    const int factors[] = {std::get<0>(temperature), std::get<1>(temperature),
+                           std::get<2>(temperature)};
+
+    for (auto brightness = 0; brightness <= 255; ++brightness) {
+      const auto tables = color_lut::build(brightness, temperature);
+      const color_lut::ChannelTable *channels[] = {&tables.r, &tables.g, &tables.b};
+
+      for (auto channel = 0; channel < 3; ++channel) {
+        for (auto c = 0; c <= 255; ++c) {
+          const auto expected = (c * brightness / 255) * factors[channel] / 255;
+          const auto actual = (*channels[channel])[c];
+          if (actual != expected && mismatches++ < 10) {
+            std::printf("kelvin %d brightness %d channel %d value %d: expected %d, got %d\n",
+                        kelvin, brightness, channel, c, expected, actual);
+          }
+        }
+      }
+    }
+  }
+
+  if (mismatches > 0) {
+    std::printf("%d mismatches\n", mismatches);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "consts.hpp"
+#include "delta_frame.hpp"
+#include "frame_messages.hpp"
+
+namespace {
+
+constexpr int width = 64;
+constexpr int height = 32;
+constexpr std::size_t frame_size = width * height * consts::pixel_size;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+template <typename T> void append_struct(std::vector<std::byte> &out, const T &value) {
+  const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// A message with one rectangle per entry, filled with `fill`.
+std::vector<std::byte> delta_message(std::initializer_list<lmz::DeltaRect> rects,
+                                     std::byte fill = std::byte{0xAB}) {
+  std::vector<std::byte> message;
+  append_struct(message, lmz::DeltaFrameHeader{.rect_count = static_cast<uint16_t>(rects.size())});
+  for (const auto &rect : rects) {
+    append_struct(message, rect);
+    message.insert(message.end(), std::size_t{rect.width} * rect.height * consts::pixel_size,
+                   fill);
+  }
+  return message;
+}
+
+// A malformed message must throw and leave every pixel of the frame as it was.
+void check_rejected(std::span<const std::byte> message, const char *what) {
+  std::vector<std::byte> frame(frame_size, std::byte{0x11});
+  const auto before = frame;
+  try {
+    delta_frame::apply(message, frame, width, height);
+    check(false, what);
+  } catch (const std::runtime_error &) {
+    check(frame == before, what);
+  }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  std::vector<std::byte> previous(frame_size);
+  for (auto &byte : previous) {
+    byte = static_cast<std::byte>(rng());
+  }
+
+  // Changes scattered over a few bands, including the last pixel, survive a round trip.
+  auto current = previous;
+  for (const auto pixel : {0, 5, width * 9 + 3, width * 20 + 40, width * height - 1}) {
+    current[pixel * consts::pixel_size] ^= std::byte{0xFF};
+  }
+  std::vector<std::byte> message;
+  check(delta_frame::encode(previous, current, width, height, message), "encode small change");
+  check(message.size() < frame_size, "delta smaller than a frame");
+
+  auto patched = previous;
+  check(delta_frame::apply(message, patched, width, height), "apply reports a change");
+  check(patched == current, "round trip");
+  check(!delta_frame::apply(message, patched, width, height), "apply again changes nothing");
+
+  // Identical frames make an empty delta.
+  check(delta_frame::encode(current, current, width, height, message), "encode no change");
+  patched = current;
+  check(!delta_frame::apply(message, patched, width, height), "empty delta changes nothing");
+  check(patched == current, "empty delta leaves the frame");
+
+  // Every pixel different is no smaller than the frame itself.
+  auto inverted = current;
+  for (auto &byte : inverted) {
+    byte = ~byte;
+  }
+  check(!delta_frame::encode(current, inverted, width, height, message), "full change not sent");
+
+  // Rectangles at the very edge are fine.
+  const auto edge = delta_message({{.x = width - 4, .y = height - 2, .width = 4, .height = 2}});
+  patched = current;
+  check(delta_frame::apply(edge, patched, width, height), "edge rectangle applies");
+
+  // A good rectangle ahead of a bad one must not be patched in either.
+  check_rejected(delta_message({{.x = 0, .y = 0, .width = 4, .height = 4},
+                                {.x = width - 3, .y = 0, .width = 4, .height = 1}}),
+                 "rectangle past the right edge");
+  check_rejected(delta_message({{.x = 0, .y = 0, .width = 4, .height = 4},
+                                {.x = 0, .y = height, .width = 1, .height = 1}}),
+                 "rectangle below the frame");
+  check_rejected(delta_message({{.x = 65535, .y = 0, .width = 2, .height = 1}}),
+                 "rectangle wrapping uint16");
+
+  auto truncated = delta_message({{.x = 0, .y = 0, .width = 4, .height = 4},
+                                  {.x = 8, .y = 8, .width = 4, .height = 4}});
+  truncated.pop_back();
+  check_rejected(truncated, "truncated pixels");
+
+  auto missing_rect = delta_message({{.x = 0, .y = 0, .width = 4, .height = 4}});
+  auto header = lmz::DeltaFrameHeader{.rect_count = 2};
+  std::memcpy(missing_rect.data(), &header, sizeof(header));
+  check_rejected(missing_rect, "missing rectangle");
+
+  auto trailing = delta_message({{.x = 0, .y = 0, .width = 4, .height = 4}});
+  trailing.push_back(std::byte{0});
+  check_rejected(trailing, "trailing data");
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("delta frames OK\n");
+  return 0;
+}
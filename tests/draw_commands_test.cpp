@@ -0,0 +1,202 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "draw_commands.hpp"
+#include "frame_messages.hpp"
+
+namespace {
+
+constexpr int width = 32;
+constexpr int height = 16;
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+void plot(std::vector<std::uint32_t> &frame, int x, int y, std::uint32_t color) {
+  if (x >= 0 && x < width && y >= 0 && y < height) {
+    frame[y * width + x] = color;
+  }
+}
+
+// Draws every pixel of the sprite or string, clipping each one on its own.
+void reference_blit(std::vector<std::uint32_t> &frame, const draw_commands::Atlas &atlas,
+                    int src_x, int src_y, int blit_width, int blit_height, int x, int y) {
+  for (auto row = 0; row < blit_height; ++row) {
+    for (auto column = 0; column < blit_width; ++column) {
+      const auto pixel = atlas.pixels[(src_y + row) * atlas.width + src_x + column];
+      if ((pixel >> 24) != 0) {
+        plot(frame, x + column, y + row, pixel);
+      }
+    }
+  }
+}
+
+void reference_text(std::vector<std::uint32_t> &frame, const draw_commands::Font &font, int x,
+                    int y, std::uint32_t color, const std::string &string) {
+  const auto row_bytes = (font.glyph_width + 7) / 8;
+  for (const auto c : string) {
+    const auto glyph = static_cast<unsigned char>(c) - font.first_char;
+    if (glyph >= 0 && glyph < font.glyph_count) {
+      const auto *bitmap = font.bitmaps.data() + glyph * row_bytes * font.glyph_height;
+      for (auto row = 0; row < font.glyph_height; ++row) {
+        for (auto column = 0; column < font.glyph_width; ++column) {
+          if (bitmap[row * row_bytes + column / 8] & (0x80 >> (column % 8))) {
+            plot(frame, x + column, y + row, color);
+          }
+        }
+      }
+    }
+    x += font.glyph_width;
+  }
+}
+
+std::vector<std::uint32_t> draw(std::span<const std::byte> message,
+                                const draw_commands::Atlas &atlas,
+                                const draw_commands::Font &font) {
+  std::vector<std::uint32_t> frame(width * height);
+  draw_commands::draw(message, frame, width, height, atlas, font);
+  return frame;
+}
+
+bool rejected(std::span<const std::byte> message, const draw_commands::Atlas &atlas,
+              const draw_commands::Font &font) {
+  try {
+    draw(message, atlas, font);
+    return false;
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+}
+
+void set_command_count(std::vector<std::byte> &message, int count) {
+  auto header = lmz::CommandsFrameHeader{};
+  std::memcpy(&header, message.data(), sizeof(header));
+  header.command_count = static_cast<std::uint16_t>(count);
+  std::memcpy(message.data(), &header, sizeof(header));
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(11);
+
+  draw_commands::Atlas atlas{.width = 24, .height = 20, .pixels = {}};
+  for (auto i = 0; i < atlas.width * atlas.height; ++i) {
+    // Every fourth pixel fully transparent.
+    atlas.pixels.push_back(i % 4 == 0 ? 0x00FFFFFF : 0xFF000000 | rng());
+  }
+
+  std::vector<std::uint8_t> bitmaps(95 * 10 * 2);
+  for (auto &byte : bitmaps) {
+    byte = static_cast<std::uint8_t>(rng());
+  }
+  const auto font = draw_commands::read_font(draw_commands::font_message(11, 10, ' ', bitmaps));
+  check(font.glyph_count == 95, "font glyph count");
+
+  // Sprites and strings at random positions, many partly or entirely off the frame, draw
+  // exactly what clipping every pixel on its own would.
+  auto mismatches = 0;
+  for (auto i = 0; i < 20000; ++i) {
+    draw_commands::CommandList commands;
+    std::vector<std::uint32_t> expected(width * height);
+
+    const int src_x = rng() % atlas.width, src_y = rng() % atlas.height;
+    const int blit_width = rng() % (atlas.width - src_x + 1);
+    const int blit_height = rng() % (atlas.height - src_y + 1);
+    const auto blit_x = static_cast<int>(rng() % 80) - 40;
+    const auto blit_y = static_cast<int>(rng() % 60) - 30;
+    commands.blit(src_x, src_y, blit_width, blit_height, blit_x, blit_y);
+    reference_blit(expected, atlas, src_x, src_y, blit_width, blit_height, blit_x, blit_y);
+
+    std::string string(rng() % 8, ' ');
+    for (auto &c : string) {
+      c = static_cast<char>(' ' + rng() % 100); // Some past the end of the font
+    }
+    const auto text_x = static_cast<int>(rng() % 120) - 80;
+    const auto text_y = static_cast<int>(rng() % 40) - 20;
+    commands.text(text_x, text_y, 0xFF00FF00, string);
+    reference_text(expected, font, text_x, text_y, 0xFF00FF00, string);
+
+    mismatches += draw(commands.message(), atlas, font) != expected;
+  }
+  check(mismatches == 0, std::to_string(mismatches) + " clipped blits and text differ");
+
+  // Long strings of big glyphs far off the frame cost nothing, rather than billions of plots.
+  const std::vector<std::uint8_t> big_bitmaps(255 * 32 * 255, 0xFF);
+  const auto big_font =
+      draw_commands::read_font(draw_commands::font_message(255, 255, 0, big_bitmaps));
+  draw_commands::CommandList far_text;
+  for (auto i = 0; i < 250; ++i) {
+    far_text.text(width, 0, 0xFFFFFFFF, std::string(255, 'A'));
+    far_text.text(0, -300, 0xFFFFFFFF, std::string(255, 'A'));
+    far_text.text(0, height, 0xFFFFFFFF, std::string(255, 'A'));
+    far_text.text(-32000, 0, 0xFFFFFFFF, std::string(100, 'A')); // Ends well left of the frame
+  }
+  check(draw(far_text.message(), atlas, big_font) == std::vector<std::uint32_t>(width * height),
+        "text off the frame");
+
+  // Fonts of more than 255 glyphs are cut short, count and bitmaps alike.
+  const std::vector<std::uint8_t> too_many(300 * 8, 0xAA);
+  const auto cut = draw_commands::read_font(draw_commands::font_message(8, 8, 0, too_many));
+  check(cut.glyph_count == 255 && cut.bitmaps.size() == 255 * 8, "font with 300 glyphs");
+
+  auto bad_font = draw_commands::font_message(8, 8, 0, std::vector<std::uint8_t>(16));
+  bad_font.pop_back();
+  try {
+    draw_commands::read_font(bad_font);
+    check(false, "font of the wrong size");
+  } catch (const std::runtime_error &) {
+  }
+
+  // Blits must come from inside the atlas.
+  draw_commands::CommandList outside;
+  outside.blit(atlas.width - 2, 0, 3, 1, 0, 0);
+  check(rejected(outside.message(), atlas, font), "blit past the atlas's right edge");
+  outside.clear();
+  outside.blit(0, atlas.height, 1, 1, 0, 0);
+  check(rejected(outside.message(), atlas, font), "blit below the atlas");
+
+  // The command count must match the commands that follow.
+  draw_commands::CommandList counted;
+  counted.fill_rect(0, 0, 4, 4, 0xFFFFFFFF);
+  counted.line(0, 0, 10, 10, 0xFFFFFFFF);
+  auto message = std::vector<std::byte>(counted.message().begin(), counted.message().end());
+  check(!rejected(message, atlas, font), "matching command count");
+  set_command_count(message, 3);
+  check(rejected(message, atlas, font), "command count too high");
+  set_command_count(message, 1);
+  check(rejected(message, atlas, font), "command count too low");
+  set_command_count(message, 2);
+  message.pop_back();
+  check(rejected(message, atlas, font), "truncated command");
+
+  draw_commands::CommandList unknown;
+  unknown.fill_rect(0, 0, 1, 1, 0);
+  message.assign(unknown.message().begin(), unknown.message().end());
+  message[sizeof(lmz::CommandsFrameHeader)] = std::byte{0x7F};
+  check(rejected(message, atlas, font), "unknown command");
+
+  draw_commands::CommandList text;
+  text.text(0, 0, 0xFFFFFFFF, "hello");
+  message.assign(text.message().begin(), text.message().end());
+  message.pop_back();
+  check(rejected(message, atlas, font), "truncated text");
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("draw commands OK\n");
+  return 0;
+}
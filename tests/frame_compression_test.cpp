@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "frame_compression.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+std::vector<std::byte> bytes(std::initializer_list<int> values) {
+  std::vector<std::byte> out;
+  for (const auto value : values) {
+    out.push_back(static_cast<std::byte>(value));
+  }
+  return out;
+}
+
+void check_round_trip(const std::vector<std::byte> &src, const std::string &what) {
+  std::vector<std::byte> compressed;
+  frame_compression::compress(src, compressed);
+
+  std::vector<std::byte> out(src.size());
+  try {
+    frame_compression::decompress(compressed, out);
+    check(out == src, what);
+  } catch (const std::runtime_error &err) {
+    check(false, what + ": " + err.what());
+  }
+
+  // A destination of any other size must be refused.
+  for (const auto size : {src.size() + 1, src.size() > 0 ? src.size() - 1 : 1}) {
+    std::vector<std::byte> wrong(size);
+    try {
+      frame_compression::decompress(compressed, wrong);
+      check(false, what + " into " + std::to_string(size) + " bytes");
+    } catch (const std::runtime_error &) {
+    }
+  }
+}
+
+void check_rejected(const std::vector<std::byte> &src, std::size_t dst_size,
+                    const std::string &what) {
+  // Guard bytes after the destination catch any write past its end.
+  std::vector<std::byte> dst(dst_size + 64, std::byte{0x5A});
+  try {
+    frame_compression::decompress(src, std::span(dst).first(dst_size));
+    check(false, what);
+  } catch (const std::runtime_error &) {
+  }
+
+  for (auto i = dst_size; i < dst.size(); ++i) {
+    if (dst[i] != std::byte{0x5A}) {
+      check(false, what + " wrote past the destination");
+      break;
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(3);
+
+  check_round_trip({}, "empty");
+  check_round_trip(bytes({7}), "one byte");
+  check_round_trip(std::vector<std::byte>(100000, std::byte{0x42}), "long run");
+
+  std::vector<std::byte> noise(70000);
+  for (auto &byte : noise) {
+    byte = static_cast<std::byte>(rng());
+  }
+  check_round_trip(noise, "noise");
+
+  // Flat panels with a few different pixels, and a repeating pattern past the 64K offset limit.
+  std::vector<std::byte> flat(128 * 64 * 4, std::byte{0});
+  for (auto i = 0; i < 50; ++i) {
+    flat[rng() % flat.size()] = static_cast<std::byte>(rng());
+  }
+  check_round_trip(flat, "mostly flat");
+
+  std::vector<std::byte> pattern(200000);
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    pattern[i] = static_cast<std::byte>((i * 7) % 251);
+  }
+  check_round_trip(pattern, "pattern");
+
+  // Hand-written sequences: token, literals, offset, extra length bytes.
+  std::vector<std::byte> out(8);
+  frame_compression::decompress(bytes({0x40, 1, 2, 3, 4, 4, 0}), out);
+  check(out == bytes({1, 2, 3, 4, 1, 2, 3, 4}), "hand-written match");
+
+  check_rejected(bytes({0x10, 1, 0, 0}), 5, "zero offset");
+  check_rejected(bytes({0x10, 1, 2, 0}), 5, "offset before the start");
+  check_rejected(bytes({0x40, 1, 2, 3, 4, 0, 1}), 300, "offset far before the start");
+  check_rejected(bytes({0x50, 1, 2, 3}), 5, "literals past the end of the input");
+  check_rejected(bytes({0x30, 1, 2, 3}), 2, "literals past the end of the output");
+  check_rejected(bytes({0xF0, 255, 255}), 1000, "truncated literal length");
+  check_rejected(bytes({0xF0, 255, 255, 255, 255, 255, 255, 255, 255, 0}), 16, "overlong literals");
+  check_rejected(bytes({0x1F, 1, 1, 0, 255, 255, 0}), 64, "overlong match");
+  check_rejected(bytes({0x14, 1, 1, 0}), 8, "match past the end of the output");
+  check_rejected(bytes({0x10, 1, 1}), 5, "truncated offset");
+  check_rejected(bytes({0x1F, 1, 1, 0}), 64, "truncated match length");
+  check_rejected(bytes({0x20, 1, 2}), 3, "output short");
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("frame compression OK\n");
+  return 0;
+}
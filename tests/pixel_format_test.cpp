@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "frame_decoder.hpp"
+#include "frame_messages.hpp"
+#include "pixel_format.hpp"
+
+namespace {
+
+using pixel_format::PixelFormat;
+
+constexpr int width = 8;
+constexpr int height = 8;
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+std::vector<std::byte> bytes(std::initializer_list<int> values) {
+  std::vector<std::byte> out;
+  for (const auto value : values) {
+    out.push_back(static_cast<std::byte>(value));
+  }
+  return out;
+}
+
+std::vector<std::uint32_t> decode(PixelFormat format, const std::vector<std::byte> &src) {
+  std::vector<std::uint32_t> out(src.size() / pixel_format::bytes_per_pixel(format));
+  pixel_format::decode(format, src, out.data(), out.size(), pixel_format::default_palette());
+  return out;
+}
+
+template <typename T> std::vector<std::byte> message(const T &header, std::size_t payload) {
+  std::vector<std::byte> out(sizeof(header) + payload);
+  std::memcpy(out.data(), &header, sizeof(header));
+  return out;
+}
+
+std::vector<std::byte> palette_message(std::size_t entries, std::size_t payload) {
+  auto out = message(
+      lmz::PaletteFrameHeader{.entry_count = static_cast<std::uint16_t>(entries)}, payload);
+  for (std::size_t i = sizeof(lmz::PaletteFrameHeader); i < out.size(); ++i) {
+    out[i] = static_cast<std::byte>(i);
+  }
+  return out;
+}
+
+// Shows every pixel of a Palette8 frame as palette entry `index`.
+std::uint32_t palette_color(lmz::FrameDecoder &decoder, int index) {
+  auto pixels = message(lmz::PixelsFrameHeader{.format = PixelFormat::Palette8}, width * height);
+  std::memset(pixels.data() + sizeof(lmz::PixelsFrameHeader), index, width * height);
+
+  std::vector<std::byte> frame(width * height * 4);
+  decoder.decode(pixels, frame);
+  std::uint32_t color;
+  std::memcpy(&color, frame.data(), sizeof(color));
+  return color;
+}
+
+bool rejected(lmz::FrameDecoder &decoder, const std::vector<std::byte> &msg) {
+  std::vector<std::byte> frame(width * height * 4);
+  try {
+    decoder.decode(msg, frame);
+    return false;
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+}
+
+} // namespace
+
+int main() {
+  // Frames are little endian RGBA32, so red is the low byte.
+  check(decode(PixelFormat::Rgb24, bytes({0x12, 0x34, 0x56, 0xFF, 0, 0})) ==
+            std::vector<std::uint32_t>{0x563412, 0x0000FF},
+        "rgb24 decode");
+  check(decode(PixelFormat::Gray8, bytes({0, 0x80, 0xFF})) ==
+            std::vector<std::uint32_t>{0, 0x808080, 0xFFFFFF},
+        "gray8 decode");
+
+  // RGB565 is little endian, and replicates its top bits so full intensity is 255.
+  check(decode(PixelFormat::Rgb565, bytes({0x00, 0xF8, 0xE0, 0x07, 0x1F, 0x00, 0xFF, 0xFF, 0x10,
+                                           0x84, 0x00, 0x00})) ==
+            std::vector<std::uint32_t>{0x0000FF, 0x00FF00, 0xFF0000, 0xFFFFFF, 0x848284, 0},
+        "rgb565 decode");
+
+  // Every RGB565 value survives decoding and encoding again.
+  auto rgb565_mismatches = 0;
+  for (std::uint32_t value = 0; value <= 0xFFFF; ++value) {
+    const auto src = bytes({static_cast<int>(value & 0xFF), static_cast<int>(value >> 8)});
+    std::vector<std::byte> encoded;
+    pixel_format::encode(PixelFormat::Rgb565, decode(PixelFormat::Rgb565, src), encoded);
+    rgb565_mismatches += encoded != src;
+  }
+  check(rgb565_mismatches == 0, std::to_string(rgb565_mismatches) + " rgb565 round trips");
+
+  std::vector<std::byte> encoded;
+  pixel_format::encode(PixelFormat::Rgb24, std::vector<std::uint32_t>{0xFF563412}, encoded);
+  check(encoded == bytes({0x12, 0x34, 0x56}), "rgb24 encode drops alpha");
+  pixel_format::encode(PixelFormat::Gray8, std::vector<std::uint32_t>{0xFFFFFF, 0xFF, 0xFF00},
+                       encoded);
+  check(encoded == bytes({255, 76, 149}), "gray8 encode");
+
+  try {
+    pixel_format::encode(PixelFormat::Palette8, std::vector<std::uint32_t>{0}, encoded);
+    check(false, "palette8 encode");
+  } catch (const std::runtime_error &) {
+  }
+
+  std::vector<std::uint32_t> out(2);
+  try {
+    pixel_format::decode(PixelFormat::Rgb24, bytes({1, 2, 3, 4, 5}), out.data(), 2,
+                         pixel_format::default_palette());
+    check(false, "short rgb24 decode");
+  } catch (const std::runtime_error &) {
+  }
+
+  // Until a palette is uploaded, Palette8 is a gray ramp.
+  lmz::FrameDecoder decoder(width, height);
+  check(palette_color(decoder, 0x40) == 0x404040, "default palette");
+
+  // An upload replaces the start of the palette only.
+  auto palette = palette_message(2, 6);
+  const auto colors = bytes({1, 2, 3, 0xFF, 0, 0x80});
+  std::copy(colors.begin(), colors.end(), palette.begin() + sizeof(lmz::PaletteFrameHeader));
+  std::vector<std::byte> frame(width * height * 4);
+  check(decoder.decode(palette, frame) == lmz::FrameDecoder::Result::NoFrame, "palette upload");
+  check(palette_color(decoder, 0) == 0x030201, "palette entry 0");
+  check(palette_color(decoder, 1) == 0x8000FF, "palette entry 1");
+  check(palette_color(decoder, 2) == 0x020202, "palette entry 2 keeps its default");
+
+  check(!rejected(decoder, palette_message(256, 256 * 3)), "full palette");
+  check(rejected(decoder, palette_message(257, 257 * 3)), "palette with 257 entries");
+  check(rejected(decoder, palette_message(4, 4 * 3 - 1)), "short palette");
+  check(rejected(decoder, palette_message(4, 4 * 3 + 1)), "palette with trailing data");
+
+  // A rejected upload leaves the palette alone.
+  lmz::FrameDecoder fresh(width, height);
+  check(rejected(fresh, palette_message(4, 4 * 3 + 1)), "bad palette");
+  check(palette_color(fresh, 1) == 0x010101, "bad palette changes nothing");
+
+  check(rejected(decoder, message(lmz::PixelsFrameHeader{.format = PixelFormat::Rgb24},
+                                  width * height * 3 - 1)),
+        "short pixels message");
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("pixel formats OK\n");
+  return 0;
+}
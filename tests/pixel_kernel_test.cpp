@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "color_temp.hpp"
+#include "pixel_kernel.hpp"
+
+// Every vector path the host supports must produce exactly what the scalar path does, whatever
+// the brightness, temperature, tail length and alignment.
+int main() {
+  constexpr std::size_t counts[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 65, 130};
+  constexpr int kelvins[] = {color_temp::min, 2700, 3200, 4000, 5000, 5600, color_temp::max};
+  constexpr std::size_t max_offset = 7;
+  constexpr std::uint32_t canary = 0xDEADBEEF;
+
+  std::mt19937 rng(42);
+  std::vector<std::uint32_t> src(counts[std::size(counts) - 1] + max_offset);
+  for (auto &pixel : src) {
+    pixel = rng();
+  }
+
+  const auto scalar = pixel_kernel::get(pixel_kernel::Path::Scalar);
+  auto failures = 0;
+
+  for (const auto path : {pixel_kernel::Path::Sse2, pixel_kernel::Path::Avx2,
+                          pixel_kernel::Path::Neon}) {
+    if (!pixel_kernel::is_supported(path)) {
+      std::printf("%s: not supported here, skipped\n", pixel_kernel::name(path));
+      continue;
+    }
+
+    const auto convert = pixel_kernel::get(path);
+    auto checked = 0;
+    for (const auto kelvin : kelvins) {
+      for (auto brightness = 0; brightness <= 255; ++brightness) {
+        const auto scale = pixel_kernel::make_scale(brightness, color_temp::get(kelvin));
+
+        for (const auto count : counts) {
+          // Offsets move src and dst off vector alignment independently.
+          for (std::size_t src_offset = 0; src_offset <= max_offset; src_offset += 3) {
+            for (std::size_t dst_offset = 0; dst_offset <= max_offset; dst_offset += 5) {
+              std::vector<std::uint32_t> expected(count);
+              std::vector<std::uint32_t> actual(count + max_offset + 1, canary);
+              scalar(src.data() + src_offset, expected.data(), count, scale);
+              convert(src.data() + src_offset, actual.data() + dst_offset, count, scale);
+              checked++;
+
+              for (std::size_t i = 0; i < actual.size(); ++i) {
+                const auto inside = i >= dst_offset && i < dst_offset + count;
+                const auto want = inside ? expected[i - dst_offset] : canary;
+                if (actual[i] != want && failures++ < 10) {
+                  std::printf("%s kelvin %d brightness %d count %zu offsets %zu/%zu pixel %zu: "
+                              "expected %08x, got %08x\n",
+                              pixel_kernel::name(path), kelvin, brightness, count, src_offset,
+                              dst_offset, i, want, actual[i]);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+
+    std::printf("%s: %d runs checked\n", pixel_kernel::name(path), checked);
+  }
+
+  if (failures > 0) {
+    std::printf("%d mismatches\n", failures);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm_ring.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+// Another process's view of the segment, for scribbling over the ring's header like a broken or
+// hostile producer would. Offsets as laid out in shm_ring.cpp.
+class Scribbler {
+public:
+  explicit Scribbler(const std::string &name) {
+    const auto fd = shm_open(name.c_str(), O_RDWR, 0);
+    memory =
+        static_cast<std::byte *>(mmap(nullptr, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+  }
+  ~Scribbler() { munmap(memory, 64); }
+
+  template <typename T> T read(std::size_t offset) const {
+    T value;
+    std::memcpy(&value, memory + offset, sizeof(value));
+    return value;
+  }
+  template <typename T> void write(std::size_t offset, T value) {
+    std::memcpy(memory + offset, &value, sizeof(value));
+  }
+
+  static constexpr std::size_t width = 8;
+  static constexpr std::size_t height = 12;
+  static constexpr std::size_t stride = 16;
+  static constexpr std::size_t middle = 24;
+
+private:
+  std::byte *memory;
+};
+
+// Publishes a frame filled with `value` and checks the consumer picks exactly that up.
+bool round_trip(lmz::ShmRing &producer, lmz::ShmRing &consumer, std::byte value) {
+  const auto frame = producer.write_frame();
+  std::memset(frame.data(), static_cast<int>(value), frame.size());
+  producer.publish();
+  if (!consumer.consume()) {
+    return false;
+  }
+
+  const auto read = consumer.read_frame();
+  for (const auto byte : read) {
+    if (byte != value) {
+      return false;
+    }
+  }
+  return read.size() == frame.size();
+}
+
+} // namespace
+
+int main() {
+  const auto name = "/lmz-test-" + std::to_string(getpid());
+  auto consumer = lmz::ShmRing::create(name, 8, 4);
+  auto producer = lmz::ShmRing::open(name);
+  Scribbler scribbler(name);
+
+  check(round_trip(producer, consumer, std::byte{1}), "first frame");
+  check(!consumer.consume(), "nothing new");
+  check(round_trip(producer, consumer, std::byte{2}), "second frame");
+
+  // A published index past the three slots is dropped, and the ring carries on afterwards.
+  auto shown = std::byte{2};
+  for (const std::uint32_t index : {3u, 7u}) {
+    const auto after = "after index " + std::to_string(index);
+    scribbler.write<std::uint32_t>(Scribbler::middle, index | 0x04);
+    check(!consumer.consume(), "slot index " + std::to_string(index));
+    check(consumer.read_frame()[0] == shown, "last good frame kept " + after);
+    check((scribbler.read<std::uint32_t>(Scribbler::middle) & 0x03) < 3,
+          "producer handed a valid slot " + after);
+
+    shown = static_cast<std::byte>(index);
+    check(round_trip(producer, consumer, shown), "frame " + after);
+  }
+
+  // Geometry rewritten after the consumer mapped the ring changes nothing it reads.
+  scribbler.write<std::uint32_t>(Scribbler::width, 4096);
+  scribbler.write<std::uint32_t>(Scribbler::height, 4096);
+  scribbler.write<std::uint64_t>(Scribbler::stride, 1 << 30);
+  check(consumer.width() == 8 && consumer.height() == 4, "consumer keeps its geometry");
+  check(consumer.frame_size() == 8 * 4 * 4, "consumer keeps its frame size");
+  check(round_trip(producer, consumer, std::byte{9}), "frame after geometry change");
+
+  // A producer mapping the ring now refuses it, as it no longer fits the segment.
+  try {
+    lmz::ShmRing::open(name);
+    check(false, "open with corrupt geometry");
+  } catch (const std::runtime_error &) {
+  }
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("shared memory ring OK\n");
+  return 0;
+}
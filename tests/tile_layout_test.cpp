@@ -0,0 +1,140 @@
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tile_layout.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+tile_layout::Layout parse(const std::string &text) {
+  std::istringstream in(text);
+  return tile_layout::parse(in);
+}
+
+bool parses(const std::string &text) {
+  try {
+    parse(text);
+    return true;
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+}
+
+// Every canvas pixel holds its own position, so a tile shows exactly where it was cut from.
+std::uint32_t pixel_at(int x, int y) { return static_cast<std::uint32_t>(y) << 16 | x; }
+
+bool cuts_correctly(const tile_layout::Layout &layout, const tile_layout::Node &node) {
+  std::vector<std::uint32_t> canvas(layout.width * layout.height);
+  for (auto y = 0; y < layout.height; ++y) {
+    for (auto x = 0; x < layout.width; ++x) {
+      canvas[y * layout.width + x] = pixel_at(x, y);
+    }
+  }
+
+  // One guard pixel past the tile catches writes beyond its end.
+  std::vector<std::uint32_t> tile(node.width * node.height + 1, 0xDEADBEEF);
+  tile_layout::cut(canvas.data(), layout.width, node, tile.data());
+
+  for (auto y = 0; y < node.height; ++y) {
+    for (auto x = 0; x < node.width; ++x) {
+      if (tile[y * node.width + x] != pixel_at(node.x + x, node.y + y)) {
+        return false;
+      }
+    }
+  }
+
+  return tile.back() == 0xDEADBEEF;
+}
+
+} // namespace
+
+int main() {
+  try {
+    const auto wall = parse("# endpoint x y width height\n"
+                            "node tcp://wall-left.local:42024 0 0 128 64\n"
+                            "\n"
+                            "node tcp://wall-right.local:42024 128 0 128 64  # second Pi\n");
+    check(wall.width == 256 && wall.height == 64, "wall size");
+    check(wall.nodes.size() == 2, "wall nodes");
+    check(wall.nodes[0].endpoint == "tcp://wall-left.local:42024", "first endpoint");
+    const auto &right = wall.nodes[1];
+    check(right.endpoint == "tcp://wall-right.local:42024" && right.x == 128 && right.y == 0 &&
+              right.width == 128 && right.height == 64,
+          "second node");
+    for (const auto &node : wall.nodes) {
+      check(cuts_correctly(wall, node), "wall tile at " + std::to_string(node.x));
+    }
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("wall layout: ") + err.what());
+  }
+
+  // A 100x50 canvas doesn't divide into 64x32 panels, so the right and bottom tiles are narrower.
+  try {
+    const auto uneven = parse("node ipc:///tmp/a 0 0 64 32\n"
+                              "node ipc:///tmp/b 64 0 36 32\n"
+                              "node ipc:///tmp/c 0 32 64 18\n"
+                              "node ipc:///tmp/d 64 32 36 18\n");
+    check(uneven.width == 100 && uneven.height == 50, "uneven size");
+    const int origins[][2] = {{0, 0}, {64, 0}, {0, 32}, {64, 32}};
+    for (std::size_t i = 0; i < uneven.nodes.size(); ++i) {
+      const auto &node = uneven.nodes[i];
+      check(node.x == origins[i][0] && node.y == origins[i][1], "uneven origin " + node.endpoint);
+      check(cuts_correctly(uneven, node), "uneven tile " + node.endpoint);
+    }
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("uneven layout: ") + err.what());
+  }
+
+  // Nodes may leave gaps. The canvas is still their bounding box.
+  try {
+    const auto sparse = parse("node ipc:///tmp/a 10 5 20 10\n"
+                              "node ipc:///tmp/b 25 40 7 3\n");
+    check(sparse.width == 32 && sparse.height == 43, "sparse size");
+    for (const auto &node : sparse.nodes) {
+      check(cuts_correctly(sparse, node), "sparse tile " + node.endpoint);
+    }
+  } catch (const std::runtime_error &err) {
+    check(false, std::string("sparse layout: ") + err.what());
+  }
+
+  check(!parses(""), "no nodes");
+  check(!parses("# just a comment\n\n"), "only comments");
+  check(!parses("node ipc:///tmp/a 0 0 64\n"), "node without height");
+  check(!parses("node ipc:///tmp/a 0 0 64 x\n"), "height not a number");
+  check(!parses("node ipc:///tmp/a -1 0 64 32\n"), "negative x");
+  check(!parses("node ipc:///tmp/a 0 -1 64 32\n"), "negative y");
+  check(!parses("node ipc:///tmp/a 0 0 0 32\n"), "zero width");
+  check(!parses("node ipc:///tmp/a 0 0 64 -32\n"), "negative height");
+  check(!parses("node ipc:///tmp/a 0 0 64 32 16\n"), "trailing number");
+  check(!parses("panel ipc:///tmp/a 0 0 64 32\n"), "unknown keyword");
+  check(!parses("node ipc:///tmp/a 2147483000 0 1000 32\n"), "right edge wrapping");
+  check(!parses("node ipc:///tmp/a 16000 0 385 32\n"), "canvas too wide");
+  check(parses("node ipc:///tmp/a 16000 0 384 16384\n"), "largest canvas");
+
+  try {
+    parse("node ipc:///tmp/a 0 0 64 32\n# second\nnode ipc:///tmp/b 64 0\n");
+    check(false, "error without line number");
+  } catch (const std::runtime_error &err) {
+    check(std::string(err.what()).find("line 3") != std::string::npos, "error line number");
+  }
+
+  if (failures > 0) {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+
+  std::printf("tile layouts OK\n");
+  return 0;
+}